@@ -0,0 +1,339 @@
+// Vault_7 benchmarks: vault7_bench <name> [args]. No window, no GL context. A separate
+// executable, so the counting operator new below stays out of the app.
+#include "vault.h"
+#ifdef __linux__
+#include <malloc.h>
+#endif
+
+#ifdef _MSC_VER
+#define V7_NOINLINE __declspec(noinline)
+#else
+#define V7_NOINLINE __attribute__((noinline))   // kept out of line so GCC doesn't pair new with free
+#endif
+
+static atomic<size_t> g_allocs{0};   // every operator new, for allocation counts in benches
+void* operator new(size_t n){ g_allocs.fetch_add(1,memory_order_relaxed); if(void* p=malloc(n?n:1)) return p; throw bad_alloc(); }
+V7_NOINLINE void operator delete(void* p) noexcept { free(p); }
+V7_NOINLINE void operator delete(void* p,size_t) noexcept { free(p); }
+
+namespace Bench {
+    using Clock = chrono::steady_clock;
+    static double ms(Clock::time_point a,Clock::time_point b){ return chrono::duration<double,milli>(b-a).count(); }
+
+    // The entry set most benches share: entry i is a Password, BackupCode or QuickNote by
+    // i%3 (service_i / account_i / note i, user_i), with secret(i) as its secret. The
+    // default is a password or code named after i and a 200-byte note.
+    static string sampleSecret(int i){ return i%3==0? "secret_password_"+to_string(i) : i%3==1? "backup_code_"+to_string(i) : string(200,'x'); }
+    static vector<unique_ptr<SensitiveData>> sampleEntries(int n,string (*secret)(int)=sampleSecret){
+        vector<unique_ptr<SensitiveData>> items; items.reserve(n);
+        for(int i=0;i<n;++i){
+            if(i%3==0) items.push_back(make_unique<Password>("service_"+to_string(i),"user_"+to_string(i),secret(i)));
+            else if(i%3==1) items.push_back(make_unique<BackupCode>("account_"+to_string(i),"user_"+to_string(i),secret(i)));
+            else items.push_back(make_unique<QuickNote>(to_string(i),secret(i)));
+        }
+        return items;
+    }
+
+    // Entry-file parsing: getline + unordered_map per file (the old loader) vs one buffer + EntryFields.
+    static int parse(int n){
+        fs::path dir=fs::temp_directory_path()/"vault7_bench_parse";
+        std::error_code ec; fs::remove_all(dir,ec); fs::create_directories(dir);
+        vector<fs::path> files; vector<string> bodies;
+        for(int i=0;i<n;++i){
+            string b = i%3==0? "SERVICE=service_"+to_string(i)+"\nUSERNAME=user_"+to_string(i)+"\nPASSWORD="+sealField('P',"service_"+to_string(i),"Password","secret_password_"+to_string(i))+"\n"
+                     : i%3==1? "ACCOUNT=account_"+to_string(i)+"\nUSERNAME=user_"+to_string(i)+"\nCODE="+sealField('B',"account_"+to_string(i),"Backup Code","backup_code_"+to_string(i))+"\n"
+                     : "NOTE_ID="+to_string(i)+"\nTEXT="+sealField('N',to_string(i),"Text",string(200,'x'))+"\n";
+            files.push_back(dir/("e"+to_string(i)+".txt")); ofstream(files.back())<<b; bodies.push_back(b);
+        }
+        auto legacy=[](istream& in,size_t& sink){
+            unordered_map<string,string> m; string line;
+            while(getline(in,line)){ auto k=line.find('='); if(k!=string::npos) m[line.substr(0,k)]=line.substr(k+1); }
+            sink += m["SERVICE"].size()+m["ACCOUNT"].size()+m["NOTE_ID"].size()+m["USERNAME"].size()+m["PASSWORD"].size()+m["CODE"].size()+m["TEXT"].size();
+        };
+        auto fields=[](int i,string_view buf,size_t& sink){   // entry i is of type i%3
+            EntryFields f; f.parse(buf,schemaOf(EntryType(i%3)));
+            for(auto v: f.v) sink += v.size();
+        };
+        auto report=[&](const char* name,auto&& body){
+            size_t sink=0, a0=g_allocs.load(); auto t0=Clock::now();
+            for(int i=0;i<n;++i) body(i,sink);
+            auto t1=Clock::now(); size_t a=g_allocs.load()-a0;
+            printf("%-26s %9.1f ns/entry %8.2f allocs/entry  (%zu)\n", name, ms(t0,t1)*1e6/n, double(a)/n, sink);
+        };
+        printf("parse: %d entry files\n", n);
+        report("memory getline+map",  [&](int i,size_t& s){ istringstream in(bodies[i]); legacy(in,s); });
+        report("memory EntryFields",  [&](int i,size_t& s){ fields(i,bodies[i],s); });
+        report("file ifstream+getline",[&](int i,size_t& s){ ifstream in(files[i]); legacy(in,s); });
+        string buf;
+        report("file readInto+fields", [&](int i,size_t& s){ if(readInto(files[i],buf)) fields(i,buf,s); });
+        fs::remove_all(dir,ec);
+        return 0;
+    }
+
+    // Entry writes through the persistence queue under each durability policy, to entry
+    // files and to the vault log: lone-edit latency (push, wait until durable without
+    // forcing a commit) and bulk throughput (push n distinct entries, flush).
+    static int durability(int n){
+        const int lone=40;
+        fs::path dir=fs::temp_directory_path()/"vault7_bench_durability";
+        const Durability policies[]={ Durability::parse("none"), Durability::parse("group"), Durability::parse("always") };
+        printf("durability: %d bulk writes, %d lone edits (group = %d ms / %d writes)\n", n, lone, policies[1].groupMs, policies[1].groupWrites);
+        printf("%-8s %-7s %10s %10s %10s %12s\n","storage","policy","p50 ms","p99 ms","avg ms","writes/s");
+        for(bool useLog: {false,true}) for(const auto& pol: policies){
+            std::error_code ec; fs::remove_all(dir,ec); fs::create_directories(dir);
+            unique_ptr<VaultLog> lg;
+            if(useLog){ lg=make_unique<VaultLog>(dir/"vault.log", dir/"vault.img"); lg->setVerbose(false); lg->open(0); }
+            PersistQueue q(pol); q.setVerbose(false); q.setLog(lg.get());
+            auto job=[&](int i,int rev){
+                string id="svc"+to_string(i);
+                return PersistQueue::Job{ PersistQueue::Job::WRITE, 'P', id, dir/(id+".txt"), "SERVICE="+id+"\nUSERNAME=user\nPASSWORD="+sealField('P',id,"Password","password_"+to_string(rev))+"\n", "PW" };
+            };
+            vector<double> lat;
+            for(int i=0;i<lone;++i){ auto t0=Clock::now(); q.push(job(i%8,i)); q.flush(false); lat.push_back(ms(t0,Clock::now())); }
+            sort(lat.begin(),lat.end());
+            double avg=accumulate(lat.begin(),lat.end(),0.0)/lat.size();
+            auto t0=Clock::now();
+            for(int i=0;i<n;++i) q.push(job(1000+i,0));
+            q.flush();
+            double total=ms(t0,Clock::now());
+            printf("%-8s %-7s %10.3f %10.3f %10.3f %12.0f\n", useLog? "log":"files", pol.name(), lat[lat.size()/2], lat[lat.size()*99/100], avg, n/(total/1000.0));
+        }
+        std::error_code ec; fs::remove_all(dir,ec);
+        return 0;
+    }
+
+    // AEAD throughput per message size on every kernel this CPU has: raw seal/open in
+    // MB/s, then whole field seal/open (synthetic nonce, base64, AAD) in entries/s for the
+    // kernel the vault would pick and for the portable reference. Open+seal per entry is
+    // the rate a bulk re-encryption runs at. Each cell runs for about budgetMs.
+    static int cipher(int budgetMs){
+        using namespace VaultCrypto;
+        using K=ChaCha20Poly1305::Kernel;
+        const size_t sizes[]={30,1024,64*1024,1024*1024};
+        uint8_t key[Aead::KEY], nonce[Aead::NONCE]={0}, tag[Aead::TAG];
+        for(size_t i=0;i<sizeof(key);++i) key[i]=uint8_t(i*7+1);
+        // calls f until the budget is used up; returns calls per second
+        auto rate=[&](auto&& f){
+            size_t calls=0; auto t0=Clock::now(); double el=0;
+            do { for(int i=0;i<8;++i) f(); calls+=8; el=ms(t0,Clock::now()); } while(el<budgetMs);
+            return calls/(el/1000.0);
+        };
+        struct Row { FieldCipher::Suite suite; unique_ptr<Aead> aead; int field; };   // field: 1 best, 0 reference, -1 neither
+        vector<Row> rows;
+        if(AesGcm::hardwareAvailable()) rows.push_back({FieldCipher::AES_GCM, make_unique<AesGcm>(key,true), 1});
+        rows.push_back({FieldCipher::AES_GCM, make_unique<AesGcm>(key,false), AesGcm::hardwareAvailable()? 0 : 1});
+        for(K k: {K::AVX2,K::SSE2,K::Scalar}){
+            bool have = k==K::Scalar || (k==K::SSE2? Cpu::get().sse2 : Cpu::get().avx2);
+            if(have) rows.push_back({FieldCipher::CHACHA20_POLY1305, make_unique<ChaCha20Poly1305>(key,k), k==ChaCha20Poly1305::best()? 1 : k==K::Scalar? 0 : -1});
+        }
+        FieldCipher fast("bench key",true), reference("bench key",false);
+        const auto& cpu=Cpu::get();
+        printf("cipher: cpu aes=%d pclmul=%d sse2=%d avx2=%d, %d ms per cell\n", cpu.aes, cpu.pclmul, cpu.sse2, cpu.avx2, budgetMs);
+        printf("%-18s %-9s %9s %11s %11s %14s %14s %14s\n","suite","kernel","size","seal MB/s","open MB/s","field seal/s","field open/s","reencrypt/s");
+        map<pair<string,size_t>,double> sealRate;   // kernel, size -> seal MB/s
+        for(auto& r: rows) for(size_t n: sizes){
+            string plain(n,'s'), out(n,'\0'), back;
+            double seal=rate([&]{ r.aead->seal(nonce,nullptr,0,(const uint8_t*)plain.data(),n,(uint8_t*)out.data(),tag); });
+            double open=rate([&]{ if(!r.aead->open(nonce,nullptr,0,(const uint8_t*)out.data(),n,tag,(uint8_t*)plain.data())) abort(); });
+            sealRate[{r.aead->kernel(),n}]=seal*n/1e6;
+            char sz[24]; if(n>=1024*1024) snprintf(sz,sizeof(sz),"%zu MB",n>>20); else if(n>=1024) snprintf(sz,sizeof(sz),"%zu KB",n>>10); else snprintf(sz,sizeof(sz),"%zu B",n);
+            printf("%-18s %-9s %9s %11.1f %11.1f", r.aead->name(), r.aead->kernel(), sz, seal*n/1e6, open*n/1e6);
+            if(r.field<0){ printf(" %14s %14s %14s\n","-","-","-"); continue; }
+            FieldCipher& fc = r.field? fast : reference; fc.use(r.suite);
+            string aad=fieldAad('N',"1","Text"), sealed=fc.seal(plain,aad);
+            double fseal=rate([&]{ sealed=fc.seal(plain,aad); });
+            double fopen=rate([&]{ if(!fc.open(sealed,aad,back)) abort(); });
+            double re=rate([&]{ if(!fc.open(sealed,aad,back)) abort(); sealed=fc.seal(back,aad); });
+            printf(" %14.0f %14.0f %14.0f\n", fseal, fopen, re);
+        }
+        const char* vec = ChaCha20Poly1305::best()==K::AVX2? "avx2" : ChaCha20Poly1305::best()==K::SSE2? "sse2" : nullptr;
+        if(vec) printf("chacha20-poly1305 %s vs scalar seal: 30 B x%.2f, 1 MB x%.2f\n", vec,
+                       sealRate[{vec,30}]/sealRate[{"scalar",30}], sealRate[{vec,1024*1024}]/sealRate[{"scalar",1024*1024}]);
+        return 0;
+    }
+
+    // Whole-vault decryption: decryptedRows per entry (the old way, one thread) against
+    // SecureVault::openBatch on pools of 1, 2, 4 .. N threads (N from VAULT7_THREADS or the
+    // core count), in entries/s.
+    static int decrypt(int n){
+        auto items=sampleEntries(n); vector<const SensitiveData*> entries;
+        for(auto& e: items) entries.push_back(e.get());
+        auto rate=[&](auto&& f){ size_t runs=0; auto t0=Clock::now(); double el=0; do { f(); ++runs; el=ms(t0,Clock::now()); } while(el<500); return runs*n/(el/1000.0); };
+        unsigned hw=WorkerPool::defaultThreads();
+        printf("decrypt: %d entries, %u cores, up to %u threads, %s\n", n, max(1u,thread::hardware_concurrency()), hw, FieldCipher::suiteName(entryCipher().suite()));
+        size_t sink=0;
+        Secret rb;
+        double rows=rate([&]{ for(auto* e: entries) sink+=e->decryptedRows("turndownforwhat",rb).n; });
+        printf("%-22s %12.0f entries/s\n", "decryptedRows", rows);
+        vector<SecureVault::Plain> out; Secret buf; double one=0;
+        vector<unsigned> sizes; for(unsigned t=1;t<hw;t*=2) sizes.push_back(t); sizes.push_back(hw);
+        for(unsigned t: sizes){
+            WorkerPool pool(t);
+            SecureVault::openBatch(pool,entries,out,buf);
+            if(any_of(out.begin(),out.end(),[](auto& p){ return !p.ok; })){ fprintf(stderr,"decrypt: batch failed\n"); return 1; }
+            size_t a0=g_allocs.load(), runs=0;
+            double r=rate([&]{ SecureVault::openBatch(pool,entries,out,buf); ++runs; });
+            if(t==1) one=r;
+            char name[32]; snprintf(name,sizeof(name),"batch, %u thread%s",t,t>1? "s":"");
+            printf("%-22s %12.0f entries/s  x%.2f vs 1 thread, x%.2f vs decryptedRows, %.2f allocs/entry\n", name, r, r/one, r/rows, double(g_allocs.load()-a0)/(double(runs)*n));
+        }
+        return sink? 0 : 1;
+    }
+
+    // Where decrypted values land per detail view: rows copied into std::string (how they
+    // were held before) against row views into one reused arena buffer, counted in
+    // general-heap and arena allocations; the sealed rows drawn every frame for comparison.
+    // Then the arena's own footprint and whether its pages could be locked.
+    static int secrets(int n){
+        auto items=sampleEntries(n);
+        auto& arena=SecureArena::get();
+        auto pass=[&](const char* name,auto&& view){
+            size_t h0=g_allocs.load(), a0=arena.stats().allocs, sink=0; auto t0=Clock::now();
+            for(auto& e: items) sink+=view(*e);
+            double el=ms(t0,Clock::now());
+            printf("%-14s %6.2f heap allocs/view  %6.2f arena allocs/view  %7.2f us/view\n", name,
+                   double(g_allocs.load()-h0)/n, double(arena.stats().allocs-a0)/n, el*1000.0/n);
+            return sink;
+        };
+        printf("secrets: %d entries, %s\n", n, FieldCipher::suiteName(entryCipher().suite()));
+        Secret buf;
+        size_t a=pass("string rows",[&](const SensitiveData& e){
+            vector<pair<string,string>> rows; size_t m=0;
+            for(auto& r: e.decryptedRows("turndownforwhat",buf)){ rows.emplace_back(string(r.label),string(r.value)); m+=rows.back().second.size(); }
+            for(auto& r: rows) VaultCrypto::wipe(&r.second[0],r.second.size());
+            return m;
+        });
+        size_t b=pass("row views",[&](const SensitiveData& e){ size_t m=0; for(auto& r: e.decryptedRows("turndownforwhat",buf)) m+=r.value.size(); return m; });
+        pass("sealed rows",[](const SensitiveData& e){ size_t m=0; for(auto& r: e.encryptedRows()) m+=r.value.size(); return m; });
+        auto st=arena.stats();
+        printf("arena: %zu chunks, %zu KiB mapped, %s (%zu lock failures), %zu large, live %zu B, peak %zu B\n",
+               st.chunks, st.mappedBytes/1024, st.lockFailures? "not all locked" : "all locked", st.lockFailures, st.large, st.live, st.peak);
+        return a==b? 0 : 1;
+    }
+
+    // Category scans: one mixed vector filtered with getType()=="..." string compares (how
+    // list building, lookups, saves and deletes scanned before) against walking the
+    // category's own container, as SecureVault::category gives it. Each scan collects the
+    // category's entries the way buildUI does. Then a lookup by id, scan against index.
+    static int scan(int n){
+        auto mixed=sampleEntries(n,[](int i)->string{ return i%3==0? "pw" : i%3==1? "code" : "note"; });
+        array<vector<const SensitiveData*>,ENTRY_TYPES> parts;
+        for(auto& e: mixed) parts[size_t(e->type())].push_back(e.get());
+        auto rate=[](auto&& f){ size_t runs=0; auto t0=Clock::now(); double el=0; do { f(); ++runs; el=ms(t0,Clock::now()); } while(el<300); return el*1000.0/runs; };
+        printf("scan: %d entries, one category at a time (us per scan)\n", n);
+        vector<const SensitiveData*> out; out.reserve(n); size_t sink=0;
+        for(size_t t=0;t<ENTRY_TYPES;++t){
+            string name=entryTypeName(EntryType(t));
+            double a=rate([&]{ out.clear(); for(auto& e: mixed) if(e->getType()==name) out.push_back(e.get()); sink+=out.size(); });
+            double b=rate([&]{ out.clear(); for(auto* e: parts[t]) out.push_back(e); sink+=out.size(); });
+            printf("%-11s getType() filter %9.1f   partition %8.1f   x%.1f\n", name.c_str(), a, b, a/b);
+        }
+        // find(type, id) as the detail view does every frame: a linear scan of the category
+        // against the (type, id) hash index the vault keeps.
+        auto& pw=parts[size_t(EntryType::Password)];
+        unordered_map<string,size_t> index; for(size_t i=0;i<pw.size();++i) index.emplace(pw[i]->getIdentifier(),i);
+        vector<string> probe; for(size_t i=0;i<256;++i) probe.push_back(pw[(i*7919)%pw.size()]->getIdentifier());
+        size_t q=0;
+        double lin=rate([&]{ const string& id=probe[q++%probe.size()]; for(auto* e: pw) if(e->getIdentifier()==id){ sink+=(size_t)e; break; } });
+        double hit=rate([&]{ for(auto& id: probe) sink+=index.find(id)->second; })/probe.size();
+        printf("find by id  linear scan %10.2f   index %12.3f   x%.0f\n", lin, hit, lin/hit);
+        return sink? 0 : 1;
+    }
+
+    // Heap bytes in use (glibc only; 0 elsewhere).
+    static size_t heapInUse(){
+#if defined(__GLIBC__) && (__GLIBC__>2 || (__GLIBC__==2 && __GLIBC_MINOR__>=33))
+        auto m=mallinfo2(); return m.uordblks+m.hblkhd;
+#else
+        return 0;
+#endif
+    }
+    // Resident bytes per entry: the entries as they are now (ciphertext only, one block
+    // each) against the layout they had before, a std::string per plaintext and sealed value.
+    static int memory(int n){
+        struct OldPw { virtual ~OldPw(){} string service,user,pwd,encPwd; bool enc=true; };
+        struct OldBc : OldPw { string code,encUser,encCode; };   // account in service
+        struct OldNt : OldPw { int serial=0; };                   // note, encNote in pwd, encPwd
+        string (*plain)(int)=[](int i){ return i%3==0? "secret_password_"+to_string(i) : i%3==1? "backup_code_"+to_string(i) : "note "+to_string(i)+": pick up the keys from the front desk"; };
+        if(!heapInUse()){ printf("memory: heap size is not available on this platform\n"); return 0; }
+        printf("memory: %d entries (passwords, backup codes, notes in turn)\n", n);
+        size_t h0=heapInUse();
+        auto items=sampleEntries(n,plain);
+        size_t now=heapInUse()-h0;
+        h0=heapInUse();
+        vector<unique_ptr<OldPw>> old; old.reserve(n);
+        for(int i=0;i<n;++i){
+            SensitiveData::Field f[MAX_VALUES]={}; items[i]->storedFields(f);
+            if(i%3==0){ auto e=make_unique<OldPw>(); e->service=items[i]->getIdentifier(); e->user=string(f[0].value); e->pwd=plain(i); e->encPwd=string(f[1].value); old.push_back(std::move(e)); }
+            else if(i%3==1){ auto e=make_unique<OldBc>(); e->service=items[i]->getIdentifier(); e->user="user_"+to_string(i); e->code=plain(i); e->encUser=string(f[0].value); e->encCode=string(f[1].value); old.push_back(std::move(e)); }
+            else { auto e=make_unique<OldNt>(); e->serial=i; e->pwd=plain(i); e->encPwd=string(f[0].value); old.push_back(std::move(e)); }
+        }
+        size_t before=heapInUse()-h0;
+        printf("%-26s %8.1f bytes/entry  %8.1f MiB\n", "plaintext + sealed strings", double(before)/n, before/1048576.0);
+        printf("%-26s %8.1f bytes/entry  %8.1f MiB  x%.2f\n", "ciphertext only, packed", double(now)/n, now/1048576.0, double(now)/before);
+        return 0;
+    }
+
+    // List orders: building a page of the password list by sorting the category on every
+    // rebuild (what a sorted list would cost without the vault's orders) against
+    // SecureVault::page over the maintained ones, then the upkeep per view. Runs a log-mode
+    // vault in a temp directory.
+    static int order(int n){
+        fs::path dir=fs::temp_directory_path()/"vault7_bench_order", cwd=fs::current_path();
+        std::error_code ec; fs::remove_all(dir,ec); fs::create_directories(dir); fs::current_path(dir);
+        size_t sink=0;
+        {
+            SecureVault v; v.setVerbose(false);
+            string error;
+            if(!v.setMaster("","bench master",error) || !v.open(SecureVault::Storage::Log)){ fs::current_path(cwd); return 1; }
+            const EntryType P=EntryType::Password; const size_t rows=9;
+            vector<string> ids; for(int i=0;i<n;++i) ids.push_back("service_"+to_string((i*7919LL)%n));
+            v.beginImport();
+            auto t0=Clock::now();
+            for(auto& id: ids) v.add(P,id,{"user","pw"});
+            double add=ms(t0,Clock::now());
+            v.endImport();
+            auto rate=[](auto&& f){ size_t runs=0; auto t0=Clock::now(); double el=0; do { f(); ++runs; el=ms(t0,Clock::now()); } while(el<300); return el*1000.0/runs; };
+            printf("order: %d passwords, first %zu rows (us per list build)\n", n, rows);
+            vector<const SensitiveData*> all;
+            double sorted=rate([&]{
+                all.clear(); for(auto& e: v.category(P)) all.push_back(e.get());
+                sort(all.begin(),all.end(),[](const SensitiveData* a,const SensitiveData* b){ return a->getIdentifier()<b->getIdentifier(); });
+                sink+=all.size()>rows? rows : all.size();
+            });
+            printf("%-20s %10.1f\n", "sort on rebuild", sorted);
+            const char* names[]={"title order","recently modified","recently viewed"};
+            for(int o=0;o<3;++o){
+                double pg=rate([&]{ sink+=v.page(P,SecureVault::Order(o),0,rows).size(); });
+                printf("%-20s %10.2f   x%.0f\n", names[o], pg, sorted/pg);
+            }
+            // scrolling a row at a time from the middle: the cursor makes it the rows moved, not the offset
+            size_t at=ids.size()/2;
+            double deep=rate([&]{ sink+=v.page(P,SecureVault::Order::Title,at,rows).size(); at=at+1<ids.size()? at+1 : ids.size()/2; });
+            printf("%-20s %10.2f   x%.0f\n", "scroll from middle", deep, sorted/deep);
+            size_t q=0;
+            double view=rate([&]{ v.viewed(P,ids[q++%ids.size()]); });
+            printf("upkeep: add %.2f us/entry (sealing and storage included), view %.3f us\n", add*1000.0/n, view);
+        }
+        fs::current_path(cwd); fs::remove_all(dir,ec);
+        return sink? 0 : 1;
+    }
+
+    static int run(int argc,char** argv){
+        string name = argc>1? argv[1] : "";
+        int n = argc>2? atoi(argv[2]) : 0;
+        if(name=="parse") return parse(n>0? n : 20000);
+        if(name=="durability") return durability(n>0? n : 2000);
+        if(name=="cipher") return cipher(n>0? n : 300);
+        if(name=="decrypt") return decrypt(n>0? n : 30000);
+        if(name=="secrets") return secrets(n>0? n : 30000);
+        if(name=="memory") return memory(n>0? n : 1000000);
+        if(name=="scan") return scan(n>0? n : 100000);
+        if(name=="order") return order(n>0? n : 100000);
+        fprintf(stderr,"usage: vault7_bench parse|durability|decrypt|secrets|memory|scan|order [entries]\n"
+                       "       vault7_bench cipher [ms per measurement]\n");
+        return 2;
+    }
+}
+
+int main(int argc,char** argv){ return Bench::run(argc,argv); }
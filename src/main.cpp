@@ -1,17 +1,11 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-#include <bits/stdc++.h>
-#include <filesystem>
-#include <fstream>
+#include "vault.h"
 
 #define STB_EASY_FONT_IMPLEMENTATION
 #include "stb_easy_font.h"
 
-using namespace std;
-namespace fs = std::filesystem;
-
-
 // ---------- UI CONFIG ----------
 constexpr float TITLE_TEXT_SCALE   = 3.2f;
 constexpr float DEFAULT_TEXT_SCALE = 2.2f;
@@ -40,8 +34,14 @@ static void drawFilled(float x,float y,float w,float h, Color c){ glColor4f(c.r,
 static void drawOutline(float x,float y,float w,float h, Color c){ glColor4f(c.r,c.g,c.b,c.a); glBegin(GL_LINE_LOOP); glVertex2f(x,y); glVertex2f(x+w,y); glVertex2f(x+w,y+h); glVertex2f(x,y+h); glEnd(); }
 
 struct TextRenderer {
-    static void print(const string& t,float x,float y, Color c=Theme::TEXT,float s=DEFAULT_TEXT_SCALE){
-        char buf[16000]; int q = stb_easy_font_print(0,0,(char*)t.c_str(),NULL,buf,sizeof(buf));
+    static void print(const string& t,float x,float y, Color c=Theme::TEXT,float s=DEFAULT_TEXT_SCALE){ print(t.c_str(),x,y,c,s); }
+    // Pieces drawn (or measured) as one line without building a string: they are joined in
+    // a stack buffer (cut at 1 KiB), wiped afterwards since a piece may be a secret.
+    static void print(initializer_list<string_view> parts,float x,float y, Color c=Theme::TEXT,float s=DEFAULT_TEXT_SCALE){ char l[1024]; join(l,parts); print(l,x,y,c,s); VaultCrypto::wipe(l,sizeof(l)); }
+    static float w(initializer_list<string_view> parts,float s=DEFAULT_TEXT_SCALE){ char l[1024]; join(l,parts); float r=w(l,s); VaultCrypto::wipe(l,sizeof(l)); return r; }
+    static void join(char (&l)[1024],initializer_list<string_view> parts){ size_t n=0; for(auto p: parts){ size_t k=min(p.size(),sizeof(l)-1-n); memcpy(l+n,p.data(),k); n+=k; } l[n]=0; }
+    static void print(const char* t,float x,float y, Color c=Theme::TEXT,float s=DEFAULT_TEXT_SCALE){
+        char buf[16000]; int q = stb_easy_font_print(0,0,(char*)t,NULL,buf,sizeof(buf));
         glPushMatrix(); glTranslatef(x,y,0); glScalef(s,s,1);
         glColor4f(c.r,c.g,c.b,c.a); glEnableClientState(GL_VERTEX_ARRAY);
         glVertexPointer(2,GL_FLOAT,16,buf); glDrawArrays(GL_QUADS,0,q*4);
@@ -51,249 +51,11 @@ struct TextRenderer {
         print(t,x+1,y+1, Color(0,0,0,c.a*0.5f), s);
         print(t,x,y,c,s);
     }
-    static float w(const string& t,float s=DEFAULT_TEXT_SCALE){ return stb_easy_font_width((char*)t.c_str())*s; }
+    static float w(const string& t,float s=DEFAULT_TEXT_SCALE){ return w(t.c_str(),s); }
+    static float w(const char* t,float s=DEFAULT_TEXT_SCALE){ return stb_easy_font_width((char*)t)*s; }
     static float h(const string& t,float s=DEFAULT_TEXT_SCALE){ return stb_easy_font_height((char*)t.c_str())*s; }
 };
 
-// ---------- DATA MODEL ----------
-class SensitiveData {
-public:
-    virtual ~SensitiveData() {}
-    virtual string getType() const = 0;       // "Password"/"BackupCode"/"QuickNote"
-    virtual string getIdentifier() const = 0; // key (service/account/note id)
-    virtual string getTitle() const = 0;      // display name on list and detail title
-    virtual vector<pair<string,string>> encryptedRows() const = 0;                 // rows to show initially
-    virtual vector<pair<string,string>> decryptedRows(const string& key) const = 0;// rows after valid key
-    virtual void edit(const string& key,const string& v1,const string& v2="") = 0; // change values
-};
-
-static string xorEnc(const string& s){ string r=s; for(char& c:r) c^=3; return r+"!@"; }
-static string xorDec(const string& s){ if(s.size()<2) return {}; string r=s.substr(0,s.size()-2); for(char& c:r) c^=3; return r; }
-static string safeFile(const string& s){ string o; o.reserve(s.size()); for(char c: s){ if((c>='a'&&c<='z')||(c>='A'&&c<='Z')||(c>='0'&&c<='9')||c=='_'||c=='-'||c=='.') o.push_back(c); else o.push_back('_'); } return o; }
-
-class Password : public SensitiveData {
-    string service, user, pwd, encPwd; bool enc;
-public:
-    Password(const string& svc,const string& u,const string& p,bool e=true):service(svc),user(u),pwd(p),enc(e){ if(enc) encPwd=xorEnc(p); }
-    string getType() const override { return "Password"; }
-    string getIdentifier() const override { return service; }
-    string getTitle() const override { return service; }
-    vector<pair<string,string>> encryptedRows() const override { return { {"Username", user}, {"Password", enc? encPwd : pwd} }; }
-    vector<pair<string,string>> decryptedRows(const string& key) const override {
-        if(enc && key!="turndownforwhat") return { {"Error", "Invalid decryption key."} };
-        return { {"Username", user}, {"Password", enc? xorDec(encPwd): pwd} };
-    }
-    void edit(const string& key,const string& v1,const string& = "") override {
-        if(key=="turndownforwhat"){ pwd=v1; if(enc) encPwd=xorEnc(v1); }
-    }
-};
-
-class BackupCode : public SensitiveData {
-    string account, user, code, encUser, encCode; bool enc;
-public:
-    BackupCode(const string& a,const string& u,const string& c,bool e=true):account(a),user(u),code(c),enc(e){ if(enc){ encUser=xorEnc(u); encCode=xorEnc(c); } }
-    string getType() const override { return "BackupCode"; }
-    string getIdentifier() const override { return account; }
-    string getTitle() const override { return account; }
-    vector<pair<string,string>> encryptedRows() const override { return { {"Username", enc? encUser : user}, {"Backup Code", enc? encCode : code} }; }
-    vector<pair<string,string>> decryptedRows(const string& key) const override {
-        if(enc && key!="turndownforwhat") return { {"Error", "Invalid decryption key."} };
-        return { {"Username", enc? xorDec(encUser): user}, {"Backup Code", enc? xorDec(encCode): code} };
-    }
-    void edit(const string& key,const string& v1,const string& v2="") override {
-        if(key=="turndownforwhat"){ user=v1; code=v2; if(enc){ encUser=xorEnc(v1); encCode=xorEnc(v2);} }
-    }
-};
-
-class QuickNote : public SensitiveData {
-    int serial; string note, encNote; bool enc;
-public:
-    QuickNote(int id,const string& n,bool e=true):serial(id),note(n),enc(e){ if(enc) encNote=xorEnc(n); }
-    string getType() const override { return "QuickNote"; }
-    string getIdentifier() const override { return to_string(serial); }
-    string getTitle() const override { return "Note "+to_string(serial); }
-    vector<pair<string,string>> encryptedRows() const override { return { {"Text", enc? "[ENCRYPTED]" : note} }; }
-    vector<pair<string,string>> decryptedRows(const string& key) const override {
-        if(enc && key!="turndownforwhat") return { {"Error", "Invalid decryption key."} };
-        return { {"Text", enc? xorDec(encNote): note} };
-    }
-    void setEncrypted(bool e){ if(e && !enc) encNote=xorEnc(note); enc=e; }
-    bool isEncrypted() const { return enc; }
-    void edit(const string& key,const string& v1,const string& = "") override {
-        if(key=="turndownforwhat"){ note=v1; if(enc) encNote=xorEnc(v1); }
-    }
-    int id() const { return serial; }
-};
-
-// ---------- STORAGE HELPERS ----------
-static string getRowValue(const vector<pair<string,string>>& rows, const string& label){
-    for(const auto& p: rows) if(p.first==label) return p.second;
-    return "";
-}
-
-// ---------- VAULT ----------
-class SecureVault {
-    string master="ilovetohatethat", key="turndownforwhat";
-    vector<unique_ptr<SensitiveData>> items;
-    int noteCounter=1;
-
-    // Password files
-    fs::path pwDir() const { return fs::path("vault_data")/"Passwords"; }
-    fs::path pwPath(const string& svc) const { return pwDir()/(safeFile(svc)+".txt"); }
-    // Backup files
-    fs::path bcDir() const { return fs::path("vault_data")/"BackupCodes"; }
-    fs::path bcPath(const string& acc) const { return bcDir()/(safeFile(acc)+".txt"); }
-    // Note files
-    fs::path ntDir() const { return fs::path("vault_data")/"Notes"; }
-    fs::path ntPath(const string& id) const { return ntDir()/("note_"+safeFile(id)+".txt"); }
-
-    void savePassword(const SensitiveData& it){
-        if(it.getType()!="Password") return;
-        fs::create_directories(pwDir());
-        auto dec = it.decryptedRows(key);
-        string name = it.getTitle();
-        string user = getRowValue(dec,"Username");
-        string pass = getRowValue(dec,"Password");
-        ofstream f(pwPath(name), ios::trunc);
-        if(!f) return;
-        f<<"SERVICE="<<name<<"\n";
-        f<<"USERNAME="<<user<<"\n";
-        f<<"PASSWORD="<<xorEnc(pass)<<"\n";
-        f.flush();
-        cout<<"[Saved PW] "<<fs::absolute(pwPath(name)).string()<<endl;
-    }
-    void saveBackup(const SensitiveData& it){
-        if(it.getType()!="BackupCode") return;
-        fs::create_directories(bcDir());
-        auto dec = it.decryptedRows(key);
-        string acc = it.getTitle();
-        string user = getRowValue(dec,"Username");
-        string code = getRowValue(dec,"Backup Code");
-        ofstream f(bcPath(acc), ios::trunc);
-        if(!f) return;
-        f<<"ACCOUNT="<<acc<<"\n";
-        f<<"USERNAME="<<user<<"\n";
-        f<<"CODE="<<xorEnc(code)<<"\n";
-        f.flush();
-        cout<<"[Saved BC] "<<fs::absolute(bcPath(acc)).string()<<endl;
-    }
-    void saveNote(const SensitiveData& it){
-        if(it.getType()!="QuickNote") return;
-        fs::create_directories(ntDir());
-        auto dec = it.decryptedRows(key);
-        string id = it.getIdentifier();
-        string text = getRowValue(dec,"Text");
-        ofstream f(ntPath(id), ios::trunc);
-        if(!f) return;
-        f<<"NOTE_ID="<<id<<"\n";
-        f<<"TEXT="<<xorEnc(text)<<"\n";
-        f.flush();
-        cout<<"[Saved NT] "<<fs::absolute(ntPath(id)).string()<<endl;
-    }
-
-public:
-    bool auth(const string& p) const { return p==master; }
-    bool validKey(const string& k) const { return k==key; }
-    vector<unique_ptr<SensitiveData>>& all(){ return items; }
-
-    // Add + persist
-    void addPassword(const string& s,const string& u,const string& p,bool e=true){
-        items.push_back(make_unique<Password>(s,u,p,e));
-        savePassword(*items.back());
-    }
-    void addBackup(const string& a,const string& u,const string& c,bool e=true){
-        items.push_back(make_unique<BackupCode>(a,u,c,e));
-        saveBackup(*items.back());
-    }
-    void addNote(const string& n,bool e=true){
-        items.push_back(make_unique<QuickNote>(noteCounter++,n,e));
-        saveNote(*items.back());
-    }
-
-    // Persist after edit
-    void savePasswordByService(const string& service){ for(auto& it: items) if(it->getType()=="Password" && it->getIdentifier()==service){ savePassword(*it); break; } }
-    void saveBackupByAccount(const string& acc){ for(auto& it: items) if(it->getType()=="BackupCode" && it->getIdentifier()==acc){ saveBackup(*it); break; } }
-    void saveNoteById(const string& id){ for(auto& it: items) if(it->getType()=="QuickNote" && it->getIdentifier()==id){ saveNote(*it); break; } }
-
-    // Delete from memory + file
-    bool deletePasswordByService(const string& service){
-        for(auto it=items.begin(); it!=items.end(); ++it){
-            if((*it)->getType()=="Password" && (*it)->getIdentifier()==service){
-                std::error_code ec; fs::remove(pwPath(service), ec);
-                items.erase(it);
-                cout<<"[Deleted PW] "<<fs::absolute(pwPath(service)).string()<<endl;
-                return true;
-            }
-        }
-        return false;
-    }
-    bool deleteBackupByAccount(const string& acc){
-        for(auto it=items.begin(); it!=items.end(); ++it){
-            if((*it)->getType()=="BackupCode" && (*it)->getIdentifier()==acc){
-                std::error_code ec; fs::remove(bcPath(acc), ec);
-                items.erase(it);
-                cout<<"[Deleted BC] "<<fs::absolute(bcPath(acc)).string()<<endl;
-                return true;
-            }
-        }
-        return false;
-    }
-    bool deleteNoteById(const string& id){
-        for(auto it=items.begin(); it!=items.end(); ++it){
-            if((*it)->getType()=="QuickNote" && (*it)->getIdentifier()==id){
-                std::error_code ec; fs::remove(ntPath(id), ec);
-                items.erase(it);
-                cout<<"[Deleted NT] "<<fs::absolute(ntPath(id)).string()<<endl;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    // Loads
-    int loadPasswords(){
-        int cnt=0; fs::path d=pwDir(); if(!fs::exists(d)) return 0;
-        for(auto& e: fs::directory_iterator(d)){
-            if(!e.is_regular_file()) continue;
-            ifstream f(e.path()); if(!f) continue;
-            unordered_map<string,string> m; string line;
-            while(getline(f,line)){ auto k=line.find('='); if(k!=string::npos) m[line.substr(0,k)]=line.substr(k+1); }
-            string name=m["SERVICE"], u=m["USERNAME"], p=xorDec(m["PASSWORD"]);
-            if(!name.empty()){ items.push_back(make_unique<Password>(name,u,p,true)); ++cnt; cout<<"[Loaded PW] "<<fs::absolute(e.path()).string()<<endl; }
-        }
-        return cnt;
-    }
-    int loadBackupCodes(){
-        int cnt=0; fs::path d=bcDir(); if(!fs::exists(d)) return 0;
-        for(auto& e: fs::directory_iterator(d)){
-            if(!e.is_regular_file()) continue;
-            ifstream f(e.path()); if(!f) continue;
-            unordered_map<string,string> m; string line;
-            while(getline(f,line)){ auto k=line.find('='); if(k!=string::npos) m[line.substr(0,k)]=line.substr(k+1); }
-            string acc=m["ACCOUNT"], u=m["USERNAME"], c=xorDec(m["CODE"]);
-            if(!acc.empty()){ items.push_back(make_unique<BackupCode>(acc,u,c,true)); ++cnt; cout<<"[Loaded BC] "<<fs::absolute(e.path()).string()<<endl; }
-        }
-        return cnt;
-    }
-    int loadNotes(){
-        int cnt=0; fs::path d=ntDir(); if(!fs::exists(d)) return 0;
-        for(auto& e: fs::directory_iterator(d)){
-            if(!e.is_regular_file()) continue;
-            ifstream f(e.path()); if(!f) continue;
-            unordered_map<string,string> m; string line;
-            while(getline(f,line)){ auto k=line.find('='); if(k!=string::npos) m[line.substr(0,k)]=line.substr(k+1); }
-            string id=m["NOTE_ID"], txt=xorDec(m["TEXT"]);
-            if(!id.empty()){
-                int nid = stoi(id);
-                items.push_back(make_unique<QuickNote>(nid,txt,true));
-                noteCounter = max(noteCounter, nid+1);
-                ++cnt; cout<<"[Loaded NT] "<<fs::absolute(e.path()).string()<<endl;
-            }
-        }
-        return cnt;
-    }
-};
-
 // ---------- WIDGETS ----------
 class Button {
     float x,y,w,h; string text; bool hover=false, press=false;
@@ -356,42 +118,104 @@ public:
 class App {
     GLFWwindow* win=nullptr; int W=1200,H=800;
     SecureVault vault;
-    enum State{
-        LOGIN,MENU,PASS_LIST,BC_LIST,NOTES,PASS_DETAIL,BC_DETAIL,NOTE_DETAIL,ADD_NOTE,ADD_PASS,ADD_BC
-    } state=LOGIN;
+    // LIST, DETAIL and ADD show the entry type in kind; their screens come from its schema.
+    // MASTER sets the master password: first thing for a new vault, or from login or the menu.
+    enum State{ LOGIN,MASTER,MENU,LIST,DETAIL,ADD } state=LOGIN;
+    EntryType kind=EntryType::Password;
 
-    unique_ptr<TextInput> inPwd,inKey,inNote,inNewUser,inNewCode,inNewPass,inNewSvc,inNewAcc;
+    unique_ptr<TextInput> inPwd,inKey;
+    vector<unique_ptr<TextInput>> inFields;   // ADD: identifier (unless numbered) and values; DETAIL: new secret values
     vector<unique_ptr<Button>> btns;
 
-    string selService, selAccount, selNote;
-    string keyCache;
+    string sel;                                // identifier of the entry in DETAIL
+    SecureVault::Order order=SecureVault::Order::Title; size_t first=0;   // LIST: sort and first row shown
+    UnlockedSession session;   // entry key and decrypted rows; locked when leaving for the menu
+    // ... or after idleLock seconds without input (VAULT7_IDLE_LOCK, 0 = never), so a
+    // window left open doesn't keep the key
+    double idleLock=60, lastInput=0;
+    int seeded=0;   // categories already checked for demo entries
 
     string status; Color statusCol; float statusAlpha=0.0f, statusTTL=0.0f;
 
+    // Unlocking runs Argon2id for about half a second by design, so login (and setting the
+    // master password, which runs it twice) hands the job and open to a worker; the UI
+    // thread shows its progress and runs what it posts in update().
+    using UnlockJob=function<bool(const function<bool(double)>&,string&)>;   // (progress, error)
+    thread unlockJob; atomic<bool> unlocking{false}, unlockCancel{false}; atomic<double> unlockProgress{0.0};
+    mutex uiMu; vector<function<void()>> uiTasks;
+    bool firstMaster=false;   // MASTER: the vault has no master password yet
+    void post(function<void()> fn){ lock_guard<mutex> lk(uiMu); uiTasks.push_back(std::move(fn)); }
+
+    void startJob(UnlockJob job){
+        if(unlocking) return;
+        if(unlockJob.joinable()) unlockJob.join();
+        unlocking=true; unlockCancel=false; unlockProgress=0.0;
+        bool opened=vault.isOpen();
+        unlockJob=thread([this,job=std::move(job),opened]{
+            auto progress=[this](double f){ unlockProgress=f; return !unlockCancel; };
+            string error;
+            bool ok=job(progress,error) && (opened || vault.open(SecureVault::defaultStorage()));
+            post([this,ok,error]{ finishUnlock(ok,error); });
+        });
+        buildUI();
+    }
+    void startUnlock(){
+        if(!inPwd) return;
+        startJob([this,pwd=inPwd->get()](const function<bool(double)>& progress,string&) mutable {
+            bool ok=vault.auth(pwd,progress);   // Cancel only stops it while Argon2id runs
+            VaultCrypto::wipe(pwd.data(),pwd.size());
+            return ok;
+        });
+    }
+    // MASTER: [current,] new and confirmation in inFields.
+    void changeMaster(){
+        vector<string_view> v=fieldValues(); size_t n=v.size();
+        if(v[n-2].empty()){ setStatus("Enter the new master password.", Theme::ERROR); return; }
+        if(v[n-2]!=v[n-1]){ setStatus("The new passwords don't match.", Theme::ERROR); return; }
+        startJob([this,current=n>2? string(v[0]) : string(),next=string(v[n-2])](const function<bool(double)>& progress,string& error) mutable {
+            bool ok=vault.setMaster(current,next,error,progress);
+            VaultCrypto::wipe(current.data(),current.size()); VaultCrypto::wipe(next.data(),next.size());
+            return ok;
+        });
+    }
+    void finishUnlock(bool ok,const string& error){
+        unlockJob.join(); unlocking=false;
+        bool master = state==MASTER;
+        if(ok){ state=MENU; buildUI(); setStatus(master? "Master password set!" : "Login successful!", Theme::SUCCESS); return; }
+        buildUI();
+        if(unlockCancel) setStatus(master? "Cancelled." : "Login cancelled.", Theme::TEXT);
+        else if(master) setStatus("Master password not set: "+error+".", Theme::ERROR, 3.0f);
+        else setStatus("Invalid password!", Theme::ERROR);
+    }
+    void leaveMaster(){ state = vault.isOpen()? MENU : LOGIN; buildUI(); }
+
 public:
-    App(){
-        // Load from files first
-        int loadedPw = vault.loadPasswords();
-        int loadedBc = vault.loadBackupCodes();
-        int loadedNt = vault.loadNotes();
-
-        // Seed demos only if none exist in that category
-        if(loadedPw==0){
-            vault.addPassword("Facebook","tijul.kabir.CSE.PUST","fb_pass",true);
-            vault.addPassword("Twitter","tijulkabbirtoha","tw_pass");
-            vault.addPassword("Instagram","tijul_kabir","ig_pass");
-            vault.addPassword("Telegram","Tijul Kabir Toha","tg_pass");
-            vault.addPassword("Reddit","Toha","rd_pass");
-            vault.addPassword("Discord","KToha","ds_pass");
+    // The vault is opened once the master password unlocks it; categories are read from
+    // storage the first time their list is shown.
+    App(){ if(const char* e=getenv("VAULT7_IDLE_LOCK")) idleLock=max(0.0,atof(e)); }
+
+    // Seed demos the first time a category is shown, only if none exist in it
+    void seedDemos(EntryType t){
+        int cat=SecureVault::categoryBit(t);
+        if(seeded&cat) return;
+        seeded|=cat;
+        if(vault.count(cat)) return;
+        if(t==EntryType::Password){
+            vault.add(t,"Facebook",{"tijul.kabir.CSE.PUST","fb_pass"});
+            vault.add(t,"Twitter",{"tijulkabbirtoha","tw_pass"});
+            vault.add(t,"Instagram",{"tijul_kabir","ig_pass"});
+            vault.add(t,"Telegram",{"Tijul Kabir Toha","tg_pass"});
+            vault.add(t,"Reddit",{"Toha","rd_pass"});
+            vault.add(t,"Discord",{"KToha","ds_pass"});
         }
-        if(loadedBc==0){
-            vault.addBackup("Gmail","user_gm","backup123");
-            vault.addBackup("TryHackMe","tijul_kabir","thm_backup");
-            vault.addBackup("HackTheBox","tijul_htb","htb_backup");
+        if(t==EntryType::BackupCode){
+            vault.add(t,"Gmail",{"user_gm","backup123"});
+            vault.add(t,"TryHackMe",{"tijul_kabir","thm_backup"});
+            vault.add(t,"HackTheBox",{"tijul_htb","htb_backup"});
         }
-        if(loadedNt==0){
-            vault.addNote("Plan for CTF challenge for 7 days");
-            vault.addNote("Recon phase completed");
+        if(t==EntryType::QuickNote){
+            vault.add(t,"",{"Plan for CTF challenge for 7 days"});
+            vault.add(t,"",{"Recon phase completed"});
         }
     }
 
@@ -422,6 +246,7 @@ public:
             if(!(act==GLFW_PRESS||act==GLFW_REPEAT)) return; ((App*)glfwGetWindowUserPointer(w))->key(key,mods);
         });
         glfwSetCharCallback(win, [](GLFWwindow*w,unsigned int cp){ ((App*)glfwGetWindowUserPointer(w))->ch(cp); });
+        glfwSetScrollCallback(win, [](GLFWwindow*w,double,double dy){ ((App*)glfwGetWindowUserPointer(w))->scroll(dy); });
 
         glViewport(0,0,W,H); glMatrixMode(GL_PROJECTION); glLoadIdentity(); glOrtho(0,W,H,0,-1,1); glMatrixMode(GL_MODELVIEW); glLoadIdentity();
         glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
@@ -431,13 +256,40 @@ public:
     }
 
     void run(){ while(!glfwWindowShouldClose(win)){ glfwPollEvents(); update(); render(); } }
-    void shutdown(){ glfwDestroyWindow(win); glfwTerminate(); }
+    void shutdown(){ session.lock(); unlockCancel=true; if(unlockJob.joinable()) unlockJob.join(); vault.flush(); glfwDestroyWindow(win); glfwTerminate(); }
 
     // ---- UI builders ----
     void setStatus(const string& s, Color c, float ttl=2.0f){ status=s; statusCol=c; statusTTL=ttl; statusAlpha=1.0f; }
-    void clearInputs(){
-        inPwd.reset(); inKey.reset(); inNote.reset(); inNewUser.reset(); inNewCode.reset(); inNewPass.reset();
-        inNewSvc.reset(); inNewAcc.reset(); btns.clear();
+    void showKey(){ if(inKey && !session.unlock(vault,inKey->get())) setStatus("Invalid decryption key.", Theme::ERROR); }
+    // Edits take the entry key the session was unlocked with.
+    bool keyEntered(){ if(session.unlocked()) return true; setStatus("Enter the decryption key first.", Theme::ERROR); return false; }
+    void clearInputs(){ inPwd.reset(); inKey.reset(); inFields.clear(); btns.clear(); }
+    vector<string_view> fieldValues() const { vector<string_view> v; for(auto& in: inFields) v.push_back(in->get()); return v; }
+    bool tooLong(const FieldSpec& f,string_view v){
+        if(f.accepts(v)) return false;
+        setStatus(string(f.label)+" is too long (at most "+to_string(f.maxLen)+" characters).", Theme::ERROR);
+        return true;
+    }
+    void addEntry(){
+        const EntrySchema& s=schemaOf(kind);
+        vector<string_view> v=fieldValues();
+        size_t first = s.numbered? 1 : 0;   // field of inFields[0]
+        if(v[0].empty()){ setStatus(string(s.fields[first].label)+" is required.", Theme::ERROR); return; }
+        for(size_t i=0;i<v.size();++i) if(tooLong(s.fields[first+i],v[i])) return;
+        string id = s.numbered? string() : string(v[0]);
+        if(!s.numbered) v.erase(v.begin());
+        if(!vault.add(kind,id,v)){ setStatus("Add failed.", Theme::ERROR); return; }
+        setStatus(string(s.noun)+" added!", Theme::SUCCESS);
+        state=LIST; buildUI();
+    }
+    void changeEntry(){
+        if(!keyEntered()) return;
+        const EntrySchema& s=schemaOf(kind);
+        vector<string_view> v=fieldValues(); size_t j=0;
+        for(size_t i=1;i<s.n;++i) if(s.fields[i].secret && tooLong(s.fields[i],v[j++])) return;
+        if(!vault.update(kind,sel,session.enteredKey(),v)){ setStatus("Update failed.", Theme::ERROR); return; }
+        session.forget(kind,sel);
+        setStatus(string(s.noun)+" updated!", Theme::SUCCESS);
     }
 
     void buildUI(){
@@ -445,40 +297,77 @@ public:
         switch(state){
             case LOGIN:{
                 float cx=W*0.5f, cy=H*0.5f;
+                if(unlocking){
+                    auto cancel = make_unique<Button>(cx-90, cy+48, 180, 50, "Cancel");
+                    cancel->onClick=[this]{ unlockCancel=true; };
+                    btns.push_back(std::move(cancel));
+                    break;
+                }
+                if(!vault.hasMaster()){ state=MASTER; buildUI(); return; }
                 inPwd = make_unique<TextInput>(cx-180, cy-20, 360, 54, "Master Password"); inPwd->setPassword(true);
                 auto login = make_unique<Button>(cx-90, cy+48, 180, 50, "Login");
                 Button* loginPtr = login.get();
-                login->onClick=[this]{ if(vault.auth(inPwd->get())){ state=MENU; buildUI(); setStatus("Login successful!", Theme::SUCCESS); } else setStatus("Invalid password!", Theme::ERROR); };
+                login->onClick=[this]{ startUnlock(); };
                 inPwd->setOnEnter([loginPtr](){ if(loginPtr && loginPtr->onClick) loginPtr->onClick(); });
                 btns.push_back(std::move(login));
+                auto change = make_unique<Button>(cx-130, cy+112, 260, 46, "Change Password");
+                change->onClick=[this]{ state=MASTER; buildUI(); };
+                btns.push_back(std::move(change));
+            } break;
+
+            case MASTER:{
+                float cx=W*0.5f, cy=H*0.5f;
+                if(unlocking){
+                    auto cancel = make_unique<Button>(cx-90, cy+48, 180, 50, "Cancel");
+                    cancel->onClick=[this]{ unlockCancel=true; };
+                    btns.push_back(std::move(cancel));
+                    break;
+                }
+                firstMaster=!vault.hasMaster();
+                if(!firstMaster){ auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ leaveMaster(); }; btns.push_back(std::move(back)); }
+                // a new vault has no current password; one from before key derivation takes the built-in one
+                if(!firstMaster || !vault.isNew()) inFields.push_back(make_unique<TextInput>(cx-180, cy-160, 360, 54, "Current Master Password"));
+                inFields.push_back(make_unique<TextInput>(cx-180, cy-90, 360, 54, "New Master Password"));
+                inFields.push_back(make_unique<TextInput>(cx-180, cy-20, 360, 54, "Confirm New Password"));
+                auto set = make_unique<Button>(cx-90, cy+48, 180, 50, "Set"); Button* setPtr = set.get();
+                set->onClick=[this]{ changeMaster(); };
+                for(auto& in: inFields){ in->setPassword(true); in->setOnEnter([setPtr](){ if(setPtr && setPtr->onClick) setPtr->onClick(); }); }
+                btns.push_back(std::move(set));
             } break;
 
             case MENU:{
-                float cx=W*0.5f, start=H*0.5f-140, w=360,h=60,g=20;
+                float cx=W*0.5f, w=360,h=50,g=14, start=H*0.5f-(ENTRY_TYPES+2)*(h+g)*0.5f+30;
                 auto add=[&](string t,float y, function<void()> fn){ auto b=make_unique<Button>(cx-w/2,start+y,w,h,t); b->onClick=fn; btns.push_back(std::move(b)); };
-                add("Passwords",0,[this]{ state=PASS_LIST; buildUI(); });
-                add("Backup Codes",h+g,[this]{ state=BC_LIST; buildUI(); });
-                add("Nuclear Launch Codes",2*(h+g),[this]{ state=NOTES; buildUI(); });
-                add("Exit",3*(h+g),[this]{ glfwSetWindowShouldClose(win,GL_TRUE); });
+                for(size_t t=0;t<ENTRY_TYPES;++t) add(schemas[t].menu,t*(h+g),[this,t]{ kind=EntryType(t); first=0; state=LIST; buildUI(); });
+                add("Master Password",ENTRY_TYPES*(h+g),[this]{ state=MASTER; buildUI(); });
+                add("Exit",(ENTRY_TYPES+1)*(h+g),[this]{ glfwSetWindowShouldClose(win,GL_TRUE); });
             } break;
 
-            case PASS_LIST:{
-                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=MENU; keyCache.clear(); buildUI(); }; btns.push_back(std::move(back));
-                auto addBtn=make_unique<Button>(W-220,30,180,46,"Add"); addBtn->onClick=[this]{ state=ADD_PASS; buildUI(); }; btns.push_back(std::move(addBtn));
+            case LIST:{
+                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=MENU; session.lock(); buildUI(); }; btns.push_back(std::move(back));
+                auto addBtn=make_unique<Button>(W-220,30,180,46,"Add"); addBtn->onClick=[this]{ state=ADD; buildUI(); }; btns.push_back(std::move(addBtn));
+                static const char* sorts[]={"Sort: A-Z","Sort: Modified","Sort: Viewed"};
+                auto sortBtn=make_unique<Button>(W-420,30,180,46,sorts[int(order)]);
+                sortBtn->onClick=[this]{ order=SecureVault::Order((int(order)+1)%3); first=0; buildUI(); }; btns.push_back(std::move(sortBtn));
+                seedDemos(kind);
+                // only the rows that fit; the wheel scrolls
+                size_t n=listRows(), total=vault.count(SecureVault::categoryBit(kind));
+                first=min(first, total>n? total-n : 0);
                 float y=140;
-                for(auto& it: vault.all()) if(it->getType()=="Password"){
+                for(auto* it: vault.page(kind,order,first,n)){
                     auto row=make_unique<Button>(160,y,W-320,50, it->getTitle());
-                    string svc=it->getIdentifier();
-                    row->onClick=[this,svc]{ selService=svc; state=PASS_DETAIL; buildUI(); };
+                    string id=it->getIdentifier();
+                    row->onClick=[this,id]{ sel=id; vault.viewed(kind,id); state=DETAIL; buildUI(); };
                     btns.push_back(std::move(row)); y+=64;
                 }
             } break;
 
-            case PASS_DETAIL:{
-                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=PASS_LIST; keyCache.clear(); buildUI(); }; btns.push_back(std::move(back));
+            case DETAIL:{
+                const EntrySchema& s=schemaOf(kind);
+                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=LIST; buildUI(); }; btns.push_back(std::move(back));
                 auto del=make_unique<Button>(W-170,30,140,46,"Delete");
                 del->onClick=[this]{
-                    if(vault.deletePasswordByService(selService)){ setStatus("Password site deleted.", Theme::SUCCESS); state=PASS_LIST; buildUI(); }
+                    if(vault.remove(kind,sel)){ session.forget(kind,sel); setStatus(string(schemaOf(kind).noun)+" deleted.", Theme::SUCCESS); state=LIST; buildUI(); }
                     else setStatus("Delete failed.", Theme::ERROR);
                 };
                 btns.push_back(std::move(del));
@@ -486,168 +375,31 @@ public:
                 inKey = make_unique<TextInput>(160,H-210,320,50,"Decryption Key");
                 auto show=make_unique<Button>(490,H-210,120,50,"Show");
                 Button* showPtr = show.get();
-                show->onClick=[this]{ keyCache=inKey->get(); };
+                show->onClick=[this]{ showKey(); };
                 inKey->setOnEnter([showPtr](){ if(showPtr && showPtr->onClick) showPtr->onClick(); });
                 btns.push_back(std::move(show));
 
-                inNewPass = make_unique<TextInput>(160,H-145,320,50,"New Password");
-                auto change=make_unique<Button>(490,H-145,120,50,"Change");
-                Button* changePtr = change.get();
-                change->onClick=[this]{
-                    for(auto& it:vault.all())
-                        if(it->getType()=="Password" && it->getIdentifier()==selService)
-                            it->edit("turndownforwhat", inNewPass->get());
-                    vault.savePasswordByService(selService);
-                    setStatus("Password updated!", Theme::SUCCESS);
-                };
-                inNewPass->setOnEnter([changePtr](){ if(changePtr && changePtr->onClick) changePtr->onClick(); });
-                btns.push_back(std::move(change));
-            } break;
-
-            // FIX: Add missing Backup Code detail UI to allow decryption and editing
-            case BC_DETAIL:{
-                auto back=make_unique<Button>(30,30,120,46,"Back");
-                back->onClick=[this]{ state=BC_LIST; keyCache.clear(); buildUI(); };
-                btns.push_back(std::move(back));
-
-                auto del=make_unique<Button>(W-170,30,140,46,"Delete");
-                del->onClick=[this]{
-                    if(vault.deleteBackupByAccount(selAccount)){ setStatus("Backup site deleted.", Theme::SUCCESS); state=BC_LIST; buildUI(); }
-                    else setStatus("Delete failed.", Theme::ERROR);
-                };
-                btns.push_back(std::move(del));
-
-                inKey = make_unique<TextInput>(160, H-210, 320, 50, "Decryption Key");
-                auto show = make_unique<Button>(490, H-210, 120, 50, "Show");
-                Button* showPtr = show.get();
-                show->onClick = [this]{ keyCache = inKey->get(); };
-                inKey->setOnEnter([showPtr](){ if (showPtr && showPtr->onClick) showPtr->onClick(); });
-                btns.push_back(std::move(show));
-
-                inNewUser = make_unique<TextInput>(160, H-145, 200, 50, "New Username");
-                inNewCode = make_unique<TextInput>(370, H-145, 200, 50, "New Backup Code");
-                auto change = make_unique<Button>(580, H-145, 120, 50, "Change");
+                // one input per secret field, then Change
+                size_t secrets=0; for(size_t i=1;i<s.n;++i) secrets+=s.fields[i].secret;
+                float x=160, w= secrets>1? 410.0f/secrets-5 : 320;
+                for(size_t i=1;i<s.n;++i) if(s.fields[i].secret){ inFields.push_back(make_unique<TextInput>(x,H-145,w,50,string("New ")+s.fields[i].label)); x+=w+10; }
+                auto change=make_unique<Button>(x,H-145,120,50,"Change");
                 Button* changePtr = change.get();
-                change->onClick = [this]{
-                    for (auto& it : vault.all()) {
-                        if (it->getType() == "BackupCode" && it->getIdentifier() == selAccount) {
-                            it->edit("turndownforwhat",
-                                     inNewUser ? inNewUser->get() : "",
-                                     inNewCode ? inNewCode->get() : "");
-                        }
-                    }
-                    vault.saveBackupByAccount(selAccount);
-                    setStatus("Backup code updated!", Theme::SUCCESS);
-                };
-                inNewUser->setOnEnter([changePtr](){ if (changePtr && changePtr->onClick) changePtr->onClick(); });
-                inNewCode->setOnEnter([changePtr](){ if (changePtr && changePtr->onClick) changePtr->onClick(); });
+                change->onClick=[this]{ changeEntry(); };
+                for(auto& in: inFields) in->setOnEnter([changePtr](){ if(changePtr && changePtr->onClick) changePtr->onClick(); });
                 btns.push_back(std::move(change));
             } break;
 
-            case BC_LIST:{
-                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=MENU; keyCache.clear(); buildUI(); }; btns.push_back(std::move(back));
-                auto addBtn=make_unique<Button>(W-220,30,180,46,"Add"); addBtn->onClick=[this]{ state=ADD_BC; buildUI(); }; btns.push_back(std::move(addBtn));
-                float y=140;
-                for(auto& it: vault.all()) if(it->getType()=="BackupCode"){
-                    auto row=make_unique<Button>(160,y,W-320,50, it->getTitle());
-                    string acc=it->getIdentifier();
-                    row->onClick=[this,acc]{ selAccount=acc; state=BC_DETAIL; buildUI(); };
-                    btns.push_back(std::move(row)); y+=64;
-                }
-            } break;
-
-            case NOTES:{
-                auto back=make_unique<Button>(30,30,120,46,"Back");
-                back->onClick=[this]{ state=MENU; keyCache.clear(); buildUI(); };
-                btns.push_back(std::move(back));
-
-                auto addBtn=make_unique<Button>(W-220,30,180,46,"Add");
-                addBtn->onClick=[this]{ state=ADD_NOTE; buildUI(); };
-                btns.push_back(std::move(addBtn));
-
-                float y=140;
-                for(auto& it: vault.all()) if(it->getType()=="QuickNote"){
-                    auto row=make_unique<Button>(160,y,W-320,50, it->getTitle());
-                    string nid = it->getIdentifier();
-                    row->onClick=[this,nid]{ selNote=nid; state=NOTE_DETAIL; buildUI(); };
-                    btns.push_back(std::move(row));
-                    y += 64;
-                }
-            } break;
-
-            case NOTE_DETAIL:{
-                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=NOTES; keyCache.clear(); buildUI(); }; btns.push_back(std::move(back));
-                auto del=make_unique<Button>(W-170,30,140,46,"Delete");
-                del->onClick=[this]{
-                    if(vault.deleteNoteById(selNote)){ setStatus("Note deleted.", Theme::SUCCESS); state=NOTES; buildUI(); }
-                    else setStatus("Delete failed.", Theme::ERROR);
-                };
-                btns.push_back(std::move(del));
-
-                inKey = make_unique<TextInput>(160,H-210,320,50,"Decryption Key");
-                auto show=make_unique<Button>(490,H-210,120,50,"Show"); Button* showPtr3 = show.get();
-                show->onClick=[this]{ keyCache=inKey->get(); };
-                inKey->setOnEnter([showPtr3](){ if(showPtr3 && showPtr3->onClick) showPtr3->onClick(); });
-                btns.push_back(std::move(show));
-
-                inNote = make_unique<TextInput>(160,H-145,420,50,"New Note Text");
-                auto change=make_unique<Button>(585,H-145,120,50,"Change"); Button* changePtr3 = change.get();
-                change->onClick=[this]{
-                    for(auto& it:vault.all()) if(it->getType()=="QuickNote" && it->getIdentifier()==selNote) it->edit("turndownforwhat", inNote->get());
-                    vault.saveNoteById(selNote);
-                    setStatus("Note updated!", Theme::SUCCESS);
-                };
-                inNote->setOnEnter([changePtr3](){ if(changePtr3 && changePtr3->onClick) changePtr3->onClick(); });
-                btns.push_back(std::move(change));
-            } break;
-
-            case ADD_NOTE:{
-                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=NOTES; buildUI(); }; btns.push_back(std::move(back));
-                float cx=W*0.5f;
-                inNote = make_unique<TextInput>(cx-300, H*0.5f, 600, 50, "Enter New Note");
-                auto add=make_unique<Button>(cx-70, H*0.5f+60, 140, 50, "Add"); Button* addPtr = add.get();
-                add->onClick=[this]{ if(!inNote->get().empty()){ vault.addNote(inNote->get()); setStatus("Note added!", Theme::SUCCESS); state=NOTES; buildUI(); } };
-                inNote->setOnEnter([addPtr](){ if(addPtr && addPtr->onClick) addPtr->onClick(); });
-                btns.push_back(std::move(add));
-            } break;
-
-            case ADD_PASS:{
-                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=PASS_LIST; buildUI(); }; btns.push_back(std::move(back));
-                float cx=W*0.5f, cy=H*0.5f-40;
-                inNewSvc  = make_unique<TextInput>(cx-240, cy-60, 480, 50, "Service (e.g., Facebook)");
-                inNewUser = make_unique<TextInput>(cx-240, cy,     230, 50, "Username");
-                inNewPass = make_unique<TextInput>(cx-240+250, cy, 230, 50, "Password");
-                auto add=make_unique<Button>(cx-70, cy+70, 140, 50, "Add"); Button* addPtr2 = add.get();
-                add->onClick=[this]{
-                    if(!inNewSvc->get().empty()){
-                        vault.addPassword(inNewSvc->get(), inNewUser?inNewUser->get():"", inNewPass?inNewPass->get():"", true);
-                        setStatus("Password site added!", Theme::SUCCESS);
-                        state=PASS_LIST; buildUI();
-                    } else setStatus("Service is required.", Theme::ERROR);
-                };
-                inNewSvc->setOnEnter([addPtr2](){ if(addPtr2 && addPtr2->onClick) addPtr2->onClick(); });
-                inNewUser->setOnEnter([addPtr2](){ if(addPtr2 && addPtr2->onClick) addPtr2->onClick(); });
-                inNewPass->setOnEnter([addPtr2](){ if(addPtr2 && addPtr2->onClick) addPtr2->onClick(); });
-                btns.push_back(std::move(add));
-            } break;
-
-            case ADD_BC:{
-                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=BC_LIST; buildUI(); }; btns.push_back(std::move(back));
-                float cx=W*0.5f, cy=H*0.5f-40;
-                inNewAcc  = make_unique<TextInput>(cx-240, cy-60, 480, 50, "Account (e.g., Gmail)");
-                inNewUser = make_unique<TextInput>(cx-240, cy,     230, 50, "Username");
-                inNewCode = make_unique<TextInput>(cx-240+250, cy, 230, 50, "Backup Code");
-                auto add=make_unique<Button>(cx-70, cy+70, 140, 50, "Add"); Button* addPtr3 = add.get();
-                add->onClick=[this]{
-                    if(!inNewAcc->get().empty()){
-                        vault.addBackup(inNewAcc->get(), inNewUser?inNewUser->get():"", inNewCode?inNewCode->get():"", true);
-                        setStatus("Backup site added!", Theme::SUCCESS);
-                        state=BC_LIST; buildUI();
-                    } else setStatus("Account is required.", Theme::ERROR);
-                };
-                inNewAcc->setOnEnter([addPtr3](){ if(addPtr3 && addPtr3->onClick) addPtr3->onClick(); });
-                inNewUser->setOnEnter([addPtr3](){ if(addPtr3 && addPtr3->onClick) addPtr3->onClick(); });
-                inNewCode->setOnEnter([addPtr3](){ if(addPtr3 && addPtr3->onClick) addPtr3->onClick(); });
+            case ADD:{
+                const EntrySchema& s=schemaOf(kind);
+                auto back=make_unique<Button>(30,30,120,46,"Back"); back->onClick=[this]{ state=LIST; buildUI(); }; btns.push_back(std::move(back));
+                // the identifier on its own row (unless numbered), the values side by side below
+                float cx=W*0.5f, cy=H*0.5f-40, w=(480-20*(s.n-2))/float(s.n-1);
+                if(!s.numbered) inFields.push_back(make_unique<TextInput>(cx-240, cy-60, 480, 50, s.fields[0].label));
+                for(size_t i=1;i<s.n;++i) inFields.push_back(make_unique<TextInput>(cx-240+(i-1)*(w+20), cy, w, 50, s.fields[i].label));
+                auto add=make_unique<Button>(cx-70, cy+70, 140, 50, "Add"); Button* addPtr = add.get();
+                add->onClick=[this]{ addEntry(); };
+                for(auto& in: inFields) in->setOnEnter([addPtr](){ if(addPtr && addPtr->onClick) addPtr->onClick(); });
                 btns.push_back(std::move(add));
             } break;
         }
@@ -655,33 +407,59 @@ public:
 
     // ---- Input routing ----
     void mouse(float x,float y,bool down){
+        lastInput=glfwGetTime();
         for(auto& b:btns) if(b->onMouse(x,y,down)) return;
         if(inPwd && inPwd->click(x,y)) return; if(inKey && inKey->click(x,y)) return;
-        if(inNote && inNote->click(x,y)) return; if(inNewUser && inNewUser->click(x,y)) return;
-        if(inNewCode && inNewCode->click(x,y)) return; if(inNewPass && inNewPass->click(x,y)) return;
-        if(inNewSvc && inNewSvc->click(x,y)) return; if(inNewAcc && inNewAcc->click(x,y)) return;
+        for(auto& in: inFields) if(in->click(x,y)) return;
     }
-    void onCursorMove(float x,float y){ for(auto& b:btns) b->onMove(x,y); }
+    void onCursorMove(float x,float y){ lastInput=glfwGetTime(); for(auto& b:btns) b->onMove(x,y); }
     void key(int key,int mods){
+        lastInput=glfwGetTime();
         if(inPwd && inPwd->key(key,mods)) return; if(inKey && inKey->key(key,mods)) return;
-        if(inNote && inNote->key(key,mods)) return; if(inNewUser && inNewUser->key(key,mods)) return;
-        if(inNewCode && inNewCode->key(key,mods)) return; if(inNewPass && inNewPass->key(key,mods)) return;
-        if(inNewSvc && inNewSvc->key(key,mods)) return; if(inNewAcc && inNewAcc->key(key,mods)) return;
+        for(auto& in: inFields) if(in->key(key,mods)) return;
 
-        if(key==GLFW_KEY_ESCAPE){
+        if(key==GLFW_KEY_ESCAPE && !unlocking){
             if(state==MENU) glfwSetWindowShouldClose(win,GL_TRUE);
-            else if(state!=LOGIN){ state=MENU; keyCache.clear(); buildUI(); }
+            else if(state==MASTER){ if(!firstMaster) leaveMaster(); }
+            else if(state!=LOGIN){ state=MENU; session.lock(); buildUI(); }
         }
     }
+    size_t listRows() const { return H>200? size_t(H-200)/64 : 1; }
+    void scroll(double dy){
+        lastInput=glfwGetTime();
+        if(state!=LIST || dy==0) return;
+        size_t step=size_t(fabs(dy)+0.5); if(!step) step=1;
+        first = dy>0? (first>step? first-step : 0) : first+step;   // buildUI clamps at the end
+        buildUI();
+    }
     void ch(unsigned cp){
+        lastInput=glfwGetTime();
         if(inPwd && inPwd->ch(cp)) return; if(inKey && inKey->ch(cp)) return;
-        if(inNote && inNote->ch(cp)) return; if(inNewUser && inNewUser->ch(cp)) return;
-        if(inNewCode && inNewCode->ch(cp)) return; if(inNewPass && inNewPass->ch(cp)) return;
-        if(inNewSvc && inNewSvc->ch(cp)) return; if(inNewAcc && inNewAcc->ch(cp)) return;
+        for(auto& in: inFields) if(in->ch(cp)) return;
     }
 
     // ---- Per-frame update & render ----
+    // Outside edits to vault_data: rebuild only the list that shows the changed category,
+    // and leave a detail view whose entry is gone.
+    void onVaultChanged(int mask){
+        session.forgetAll();
+        bool rebuild = state==LIST && (mask&SecureVault::categoryBit(kind));
+        if(state==DETAIL && !vault.find(kind,sel)){ state=LIST; rebuild=true; }
+        if(rebuild) buildUI();
+        if(state!=LOGIN) setStatus("Vault changed on disk - reloaded.", Theme::ACCENT);
+    }
+
     void update(){
+        vector<function<void()>> tasks;
+        { lock_guard<mutex> lk(uiMu); tasks.swap(uiTasks); }
+        for(auto& t: tasks) t();
+        // the vault belongs to the unlock job until it reports back
+        if(!unlocking) if(int changed=vault.syncExternal()) onVaultChanged(changed);
+        session.expire();
+        if(session.unlocked() && idleLock>0 && glfwGetTime()-lastInput>idleLock){
+            session.lock();
+            setStatus("Decryption key locked after inactivity.", Theme::TEXT, 3.0f);
+        }
         if(statusTTL>0){ statusTTL-=0.016f; if(statusTTL<0) statusTTL=0; if(statusTTL<0.6f) statusAlpha=statusTTL/0.6f; }
         else statusAlpha=max(0.0f, statusAlpha-0.02f);
     }
@@ -692,33 +470,37 @@ public:
         drawOutline(0,0,(float)W,90, Color(0.25f,0.25f,0.28f,1));
     }
 
-    void renderDetail(const string& type, const string& id){
-        for(auto& it: vault.all()){
-            if(it->getType()==type && it->getIdentifier()==id){
-                string title = it->getTitle();
-                float tx = (W - TextRenderer::w(title, TITLE_TEXT_SCALE))*0.5f;
-                TextRenderer::print(title, tx, 18, Theme::ACCENT, TITLE_TEXT_SCALE);
+    void renderDetail(EntryType type, const string& id){
+        SensitiveData* it=vault.find(type,id);   // loads this one body only
+        if(!it) return;
+        string_view prefix = SensitiveData::titlePrefix(type);
+        float tx = (W - TextRenderer::w({prefix, id}, TITLE_TEXT_SCALE))*0.5f;
+        TextRenderer::print({prefix, id}, tx, 18, Theme::ACCENT, TITLE_TEXT_SCALE);
 
-                float y = 180.0f;
-                for(auto& r: it->encryptedRows()){
-                    TextRenderer::print(r.first + ": " + r.second, 160, y, Theme::TEXT, DEFAULT_TEXT_SCALE);
-                    y += 40;
-                }
-                if(!keyCache.empty()){
-                    auto dec = it->decryptedRows(keyCache);
-                    Color c = (dec.size()==1 && dec[0].first=="Error")? Theme::ERROR : Theme::SUCCESS;
-                    y += 8;
-                    for(auto& r: dec){
-                        string label = (r.first=="Error")? r.first : ("Decrypted " + r.first);
-                        TextRenderer::print(label + ": " + r.second, 160, y, c, DEFAULT_TEXT_SCALE);
-                        y += 40;
-                    }
-                }
-                break;
+        // every frame: row views and the session cache, nothing allocated
+        float y = 180.0f;
+        for(auto& r: it->encryptedRows()){
+            TextRenderer::print({r.label, ": ", r.value}, 160, y, Theme::TEXT, DEFAULT_TEXT_SCALE);
+            y += 40;
+        }
+        if(session.unlocked()){
+            auto& dec = session.rows(*it, id);
+            Color c = dec.ok? Theme::SUCCESS : Theme::ERROR;
+            y += 8;
+            for(auto& r: dec){
+                TextRenderer::print({dec.ok? "Decrypted " : "", r.label, ": ", r.value}, 160, y, c, DEFAULT_TEXT_SCALE);
+                y += 40;
             }
         }
     }
 
+    void renderProgress(){
+        float cx=W*0.5f, bw=360, by=H*0.5f-20;
+        drawFilled(cx-bw/2, by, bw, 24, Theme::INPUT);
+        drawFilled(cx-bw/2, by, bw*(float)min(1.0,unlockProgress.load()), 24, Theme::ACCENT);
+        drawOutline(cx-bw/2, by, bw, 24, Color(0.3f,0.3f,0.35f,1));
+    }
+
     void renderCredits(){
         string l1 = "Inspired by Julian Assange";
         string l2 = "Creator: Tijul Kabir Toha";
@@ -741,8 +523,18 @@ public:
                 float cx=W*0.5f;
                 string t="VAULT_7";
                 TextRenderer::print(t, cx-TextRenderer::w(t,TITLE_TEXT_SCALE)/2.0f, 24, Theme::ACCENT, TITLE_TEXT_SCALE);
-                string s="Enter Master Password:";
+                string s= unlocking? (unlockCancel? "Cancelling..." : "Unlocking vault...") : "Enter Master Password:";
                 TextRenderer::print(s, cx-TextRenderer::w(s)/2.0f, H*0.35f, Theme::TEXT);
+                if(unlocking) renderProgress();
+            } break;
+
+            case MASTER:{
+                float cx=W*0.5f;
+                string t="VAULT_7";
+                TextRenderer::print(t, cx-TextRenderer::w(t,TITLE_TEXT_SCALE)/2.0f, 24, Theme::ACCENT, TITLE_TEXT_SCALE);
+                string s= unlocking? (unlockCancel? "Cancelling..." : "Sealing the vault key...") : (firstMaster? "Create a Master Password:" : "Change Master Password:");
+                TextRenderer::print(s, cx-TextRenderer::w(s)/2.0f, unlocking? H*0.35f : H*0.5f-220, Theme::TEXT);
+                if(unlocking) renderProgress();
             } break;
 
             case MENU:{
@@ -751,42 +543,21 @@ public:
                 renderCredits();
             } break;
 
-            case PASS_LIST:{
-                TextRenderer::print("Select a Password Entry",160,110, Theme::ACCENT);
+            case LIST:{
+                TextRenderer::print(schemaOf(kind).heading,160,110, Theme::ACCENT);
             } break;
 
-            case BC_LIST:{
-                TextRenderer::print("Select a Backup Code Entry",160,110, Theme::ACCENT);
-            } break;
-
-            case NOTES:{
-                TextRenderer::print("QUICK NOTES - NUCLEAR LAUNCH CODES",120,110, Theme::ACCENT);
-            } break;
+            case DETAIL: renderDetail(kind, sel); break;
 
-            case PASS_DETAIL: renderDetail("Password", selService); break;
-            case BC_DETAIL:   renderDetail("BackupCode", selAccount); break;
-            case NOTE_DETAIL: renderDetail("QuickNote", selNote); break;
-
-            case ADD_NOTE:{
-                string t="Add a New Note";
-                TextRenderer::print(t, W*0.5f-TextRenderer::w(t)/2.0f, H*0.5f-120, Theme::ACCENT);
-            } break;
-
-            case ADD_PASS:{
-                string t="Add Password Site";
-                TextRenderer::print(t, W*0.5f-TextRenderer::w(t)/2.0f, H*0.5f-120, Theme::ACCENT);
-            } break;
-
-            case ADD_BC:{
-                string t="Add Backup Site";
+            case ADD:{
+                string t=string("Add ")+schemaOf(kind).noun;
                 TextRenderer::print(t, W*0.5f-TextRenderer::w(t)/2.0f, H*0.5f-120, Theme::ACCENT);
             } break;
         }
 
         for(auto& b:btns) b->render();
-        if(inPwd) inPwd->render(); if(inKey) inKey->render(); if(inNote) inNote->render();
-        if(inNewUser) inNewUser->render(); if(inNewCode) inNewCode->render(); if(inNewPass) inNewPass->render();
-        if(inNewSvc) inNewSvc->render(); if(inNewAcc) inNewAcc->render();
+        if(inPwd) inPwd->render(); if(inKey) inKey->render();
+        for(auto& in: inFields) in->render();
 
         if(!status.empty() && statusAlpha>0.01f){
             Color c=statusCol; c.a*=statusAlpha;
@@ -796,16 +567,363 @@ public:
     }
 };
 
-int main(){
+// ---------- COMMAND LINE ----------
+// Headless bulk import/export: Vault_7 import|export [options] [file|-]. No window, no GL
+// context. Rows are streamed one at a time in either direction; columns are
+// type,id,username,secret with type an EntrySchema::cli name and the secret in plaintext.
+// username and secret are an entry's two values in field order (a note has only a secret).
+namespace Cli {
+    static_assert(MAX_VALUES<=2, "import/export has two value columns; a type with more values needs columns for them");
+    enum class Format { CSV, JSONL };
+
+    static optional<EntryType> typeOf(string_view t){
+        for(auto& s: schemas) if(t==s.cli || t==s.name) return s.type;
+        return nullopt;
+    }
+    static const char* typeName(EntryType t){ return schemaOf(t).cli; }
+
+    // Buffered byte source over a FILE*, so parsers can work char by char cheaply.
+    class Input {
+        FILE* f; vector<char> buf=vector<char>(1<<16); size_t pos=0, len=0;
+    public:
+        explicit Input(FILE* in):f(in){}
+        int get(){ if(pos==len){ len=fread(buf.data(),1,buf.size(),f); pos=0; if(!len) return EOF; } return (unsigned char)buf[pos++]; }
+        int peek(){ int c=get(); if(c!=EOF) --pos; return c; }
+        bool line(string& out){ out.clear(); int c; while((c=get())!=EOF && c!='\n') out.push_back((char)c); if(!out.empty() && out.back()=='\r') out.pop_back(); return c!=EOF || !out.empty(); }
+    };
+
+    // RFC 4180: fields may be quoted, "" is a literal quote, quoted fields may span lines.
+    // Fills fields (reusing its strings) and returns false at end of input.
+    static bool csvRow(Input& in,vector<string>& fields,size_t& lineNo){
+        size_t n=0; int c=in.peek();
+        if(c==EOF) return false;
+        ++lineNo;
+        for(;;){
+            if(fields.size()<=n) fields.emplace_back();
+            string& f=fields[n++]; f.clear();
+            c=in.get();
+            if(c=='"'){
+                for(;;){
+                    c=in.get();
+                    if(c==EOF) break;
+                    if(c=='"'){ if(in.peek()=='"'){ in.get(); f.push_back('"'); continue; } c=in.get(); break; }
+                    if(c=='\n') ++lineNo;
+                    f.push_back((char)c);
+                }
+                while(c!=',' && c!='\n' && c!=EOF) c=in.get();   // junk after the closing quote
+            } else {
+                while(c!=',' && c!='\n' && c!=EOF){ f.push_back((char)c); c=in.get(); }
+            }
+            if(c==','){ continue; }
+            if(!f.empty() && f.back()=='\r') f.pop_back();
+            fields.resize(n);
+            return true;
+        }
+    }
+    static void csvField(FILE* out,string_view s){
+        if(s.find_first_of(",\"\r\n")==string::npos){ fwrite(s.data(),1,s.size(),out); return; }
+        fputc('"',out);
+        for(char c: s){ if(c=='"') fputc('"',out); fputc(c,out); }
+        fputc('"',out);
+    }
+
+    static void putUtf8(string& o,uint32_t cp){
+        if(cp<0x80) o.push_back((char)cp);
+        else if(cp<0x800){ o.push_back((char)(0xC0|cp>>6)); o.push_back((char)(0x80|(cp&0x3F))); }
+        else if(cp<0x10000){ o.push_back((char)(0xE0|cp>>12)); o.push_back((char)(0x80|((cp>>6)&0x3F))); o.push_back((char)(0x80|(cp&0x3F))); }
+        else { o.push_back((char)(0xF0|cp>>18)); o.push_back((char)(0x80|((cp>>12)&0x3F))); o.push_back((char)(0x80|((cp>>6)&0x3F))); o.push_back((char)(0x80|(cp&0x3F))); }
+    }
+    // One flat JSON object per line: {"type":..,"id":..,"username":..,"secret":..}. String
+    // or integer values; other keys are ignored. Returns false on malformed input.
+    static bool jsonRow(string_view s,string& type,string& id,string& user,string& secret){
+        size_t i=0;
+        auto ws=[&]{ while(i<s.size() && (s[i]==' '||s[i]=='\t'||s[i]=='\r')) ++i; };
+        auto hex4=[&](uint32_t& v){ if(i+4>s.size()) return false; v=0; for(int k=0;k<4;++k){ char c=s[i++]; v<<=4; if(c>='0'&&c<='9') v|=c-'0'; else if(c>='a'&&c<='f') v|=c-'a'+10; else if(c>='A'&&c<='F') v|=c-'A'+10; else return false; } return true; };
+        auto str=[&](string& o){
+            o.clear(); if(i>=s.size() || s[i]!='"') return false; ++i;
+            while(i<s.size() && s[i]!='"'){
+                char c=s[i++];
+                if(c!='\\'){ o.push_back(c); continue; }
+                if(i>=s.size()) return false;
+                switch(char e=s[i++]){
+                    case 'n': o.push_back('\n'); break; case 't': o.push_back('\t'); break;
+                    case 'r': o.push_back('\r'); break; case 'b': o.push_back('\b'); break;
+                    case 'f': o.push_back('\f'); break;
+                    case 'u':{
+                        uint32_t cp; if(!hex4(cp)) return false;
+                        if(cp>=0xD800 && cp<0xDC00 && i+1<s.size() && s[i]=='\\' && s[i+1]=='u'){
+                            i+=2; uint32_t lo; if(!hex4(lo) || lo<0xDC00 || lo>0xDFFF) return false;
+                            cp=0x10000+((cp-0xD800)<<10)+(lo-0xDC00);
+                        }
+                        putUtf8(o,cp);
+                    } break;
+                    default: o.push_back(e);
+                }
+            }
+            if(i>=s.size()) return false;
+            ++i; return true;
+        };
+        type.clear(); id.clear(); user.clear(); secret.clear();
+        ws(); if(i>=s.size() || s[i]!='{') return false; ++i;
+        string k, v;
+        for(ws(); i<s.size() && s[i]!='}'; ){
+            if(!str(k)) return false;
+            ws(); if(i>=s.size() || s[i]!=':') return false; ++i; ws();
+            if(i<s.size() && s[i]=='"'){ if(!str(v)) return false; }
+            else { size_t b=i; while(i<s.size() && (isalnum((unsigned char)s[i])||s[i]=='-'||s[i]=='.')) ++i; v.assign(s.substr(b,i-b)); if(v=="null") v.clear(); }
+            if(k=="type") type=v; else if(k=="id") id=v; else if(k=="username") user=v; else if(k=="secret") secret=v;
+            ws(); if(i<s.size() && s[i]==','){ ++i; ws(); }
+        }
+        return i<s.size();
+    }
+    static void jsonString(FILE* out,string_view s){
+        fputc('"',out);
+        for(unsigned char c: s){
+            if(c=='"'||c=='\\'){ fputc('\\',out); fputc(c,out); }
+            else if(c=='\n') fputs("\\n",out); else if(c=='\r') fputs("\\r",out); else if(c=='\t') fputs("\\t",out);
+            else if(c<0x20) fprintf(out,"\\u%04x",c);
+            else fputc(c,out);
+        }
+        fputc('"',out);
+    }
+
+    static int usage(){
+        fprintf(stderr,
+            "usage: Vault_7 import [--format csv|jsonl] [file|-]\n"
+            "       Vault_7 export [--format csv|jsonl] [file|-]\n"
+            "       Vault_7 calibrate [--target-ms <ms>] [--master <password>]\n"
+            "       Vault_7 rotate --new-key <key> [--master <password>] [--key <key>]\n"
+            "       Vault_7 passwd --new-master <password> [--master <password>]\n"
+            "  columns: type,id,username,secret (type: password|backup|note|totp|ssh|card; secret in plaintext)\n"
+            "  credentials: --master <password> or VAULT7_MASTER; export also --key <key> or VAULT7_KEY\n"
+            "  calibrate: picks Argon2id costs that take about <ms> (default 500) to unlock here;\n"
+            "             with a master password the vault key is rewrapped with them\n"
+            "  rotate: re-encrypts every entry under a new data key and sets a new entry key\n"
+            "          (also VAULT7_NEW_KEY); an interrupted rotation resumes when run again\n"
+            "  passwd: sets the master password (also VAULT7_NEW_MASTER); a new vault needs one\n"
+            "          before anything else, and one from before key derivation takes the built-in\n"
+            "          password as --master once\n");
+        return 2;
+    }
+
+    static int importRows(SecureVault& vault,FILE* in,Format fmt){
+        Input src(in);
+        size_t lineNo=0, ok=0, bad=0;
+        auto t0=chrono::steady_clock::now();
+        auto add=[&](const string& type,const string& id,const string& user,const string& secret){
+            if(auto t=typeOf(type)){
+                vector<string_view> v; if(schemaOf(*t).n>2) v.push_back(user); v.push_back(secret);
+                if(vault.add(*t,id,v)){ ++ok; return; }
+            }
+            if(++bad<=20) fprintf(stderr,"[Import] line %zu: skipped (type '%s', id '%s')\n", lineNo, type.c_str(), id.c_str());
+        };
+        vault.beginImport();
+        if(fmt==Format::CSV){
+            vector<string> f; bool first=true;
+            while(csvRow(src,f,lineNo)){
+                if(f.size()==1 && f[0].empty()) continue;
+                if(first && f[0]=="type"){ first=false; continue; }
+                first=false;
+                f.resize(max<size_t>(f.size(),4));
+                add(f[0],f[1],f[2],f[3]);
+            }
+        } else {
+            string line, type, id, user, secret;
+            while(src.line(line)){
+                ++lineNo;
+                if(line.find_first_not_of(" \t\r")==string::npos) continue;
+                if(jsonRow(line,type,id,user,secret)) add(type,id,user,secret);
+                else if(++bad<=20) fprintf(stderr,"[Import] line %zu: malformed JSON\n", lineNo);
+            }
+        }
+        vault.endImport();
+        double s=chrono::duration<double>(chrono::steady_clock::now()-t0).count();
+        fprintf(stderr,"[Import] %zu entries stored, %zu skipped in %.2f s (%.0f entries/s)\n", ok, bad, s, ok/max(s,1e-9));
+        return bad? 1 : 0;
+    }
+
+    static int exportRows(SecureVault& vault,const string& key,FILE* out,Format fmt){
+        if(fmt==Format::CSV) fputs("type,id,username,secret\n",out);
+        size_t n=0, bad=0;
+        vector<SecureVault::Plain> batch; Secret buf;
+        vector<const SensitiveData*> slice;
+        // A slice of a category at a time, decrypted in parallel into the same buffer, then
+        // written and wiped: the plaintext held at once stays bounded whatever the vault's size.
+        const size_t SLICE=4096;
+        for(auto& sc: schemas){
+            auto& items=vault.category(sc.type);
+            for(size_t at=0; at<items.size(); at+=SLICE){
+                slice.clear();
+                for(size_t i=at;i<min(items.size(),at+SLICE);++i) slice.push_back(items[i].get());
+                if(!vault.decryptBatch(slice,key,batch,buf)){ fprintf(stderr,"[Export] invalid decryption key\n"); return 1; }
+                for(auto& p: batch){
+                    const char* type=typeName(p.entry->type());
+                    string id=p.entry->getIdentifier();
+                    if(!p.ok){ fprintf(stderr,"[Export] %s '%s' skipped: %s\n", type, id.c_str(), authError.second.c_str()); ++bad; continue; }
+                    if(fmt==Format::CSV){
+                        fputs(type,out); fputc(',',out); csvField(out,id); fputc(',',out); csvField(out,p.user()); fputc(',',out); csvField(out,p.secret()); fputc('\n',out);
+                    } else {
+                        fprintf(out,"{\"type\":\"%s\",\"id\":",type); jsonString(out,id);
+                        fputs(",\"username\":",out); jsonString(out,p.user());
+                        fputs(",\"secret\":",out); jsonString(out,p.secret()); fputs("}\n",out);
+                    }
+                    ++n;
+                }
+                batch.clear(); buf.clear();
+            }
+        }
+        if(fflush(out)!=0 || ferror(out)){ fprintf(stderr,"[Export] write failed\n"); return 1; }
+        fprintf(stderr,"[Export] %zu entries\n", n);
+        return bad? 1 : 0;
+    }
+
+    static int run(int argc,char** argv){
+        string cmd=argv[1], path="-", fmtName;
+        string master = getenv("VAULT7_MASTER")? getenv("VAULT7_MASTER") : "";
+        string key    = getenv("VAULT7_KEY")? getenv("VAULT7_KEY") : "";
+        for(int i=2;i<argc;++i){
+            string a=argv[i];
+            if(a=="--format" && i+1<argc) fmtName=argv[++i];
+            else if(a=="--master" && i+1<argc) master=argv[++i];
+            else if(a=="--key" && i+1<argc) key=argv[++i];
+            else if(a.size()>1 && a[0]=='-' && a!="-") return usage();
+            else path=a;
+        }
+        if(fmtName.empty()){
+            string ext=fs::path(path).extension().string();
+            fmtName = ext==".jsonl" || ext==".json" || ext==".ndjson"? "jsonl" : "csv";
+        }
+        if(fmtName!="csv" && fmtName!="jsonl") return usage();
+        Format fmt = fmtName=="csv"? Format::CSV : Format::JSONL;
+
+        // Vault diagnostics go to stderr so an export to stdout stays clean.
+        cout.rdbuf(cerr.rdbuf());
+        SecureVault vault; vault.setVerbose(false);
+        if(!vault.auth(master)){
+            if(!vault.hasMaster()) fprintf(stderr,"The vault has no master password yet: set one with Vault_7 passwd\n");
+            else fprintf(stderr,"Access denied: set VAULT7_MASTER or pass --master\n");
+            return 1;
+        }
+        if(cmd=="export" && !vault.validKey(key)){ fprintf(stderr,"Invalid decryption key: set VAULT7_KEY or pass --key\n"); return 1; }
+        if(!vault.open(SecureVault::defaultStorage())){ fprintf(stderr,"Cannot open the vault\n"); return 1; }
+
+        bool console = path=="-";
+        FILE* f = console? (cmd=="import"? stdin : stdout) : fopen(path.c_str(), cmd=="import"? "rb" : "wb");
+        if(!f){ fprintf(stderr,"Cannot open %s\n", path.c_str()); return 1; }
+        static char obuf[1<<16]; if(cmd=="export") setvbuf(f,obuf,_IOFBF,sizeof(obuf));
+        int rc = cmd=="import"? importRows(vault,f,fmt) : exportRows(vault,key,f,fmt);
+        if(!console && fclose(f)!=0 && rc==0){ fprintf(stderr,"Cannot write %s\n", path.c_str()); rc=1; }
+        vault.flush();
+        return rc;
+    }
+
+    // Argon2id costs that take about targetMs to unlock on this machine: one lane per core
+    // (up to 8), three passes and as much memory as the budget buys, up to 1 GiB; past that
+    // the passes go up instead. Measured and corrected until within 10%.
+    static int calibrate(int argc,char** argv){
+        using VaultCrypto::Argon2id;
+        int target=500;
+        string master = getenv("VAULT7_MASTER")? getenv("VAULT7_MASTER") : "";
+        for(int i=2;i<argc;++i){
+            string a=argv[i];
+            if(a=="--target-ms" && i+1<argc) target=atoi(argv[++i]);
+            else if(a=="--master" && i+1<argc) master=argv[++i];
+            else return usage();
+        }
+        if(target<=0) return usage();
+        const uint32_t minKiB=8*1024, maxKiB=1024*1024;
+        Argon2id::Params p; p.lanes=clamp(thread::hardware_concurrency(),1u,8u); p.passes=3; p.memoryKiB=16*1024;
+        auto timeIt=[](const Argon2id::Params& q){
+            uint8_t salt[16]={0}, out[32];
+            auto t0=chrono::steady_clock::now();
+            Argon2id::derive("calibrate",9,salt,sizeof(salt),q,out,sizeof(out));
+            return chrono::duration<double,milli>(chrono::steady_clock::now()-t0).count();
+        };
+        auto show=[](const Argon2id::Params& q,double t){ printf("  memory %6u KiB  passes %2u  lanes %u  %8.0f ms\n", q.memoryKiB, q.passes, q.lanes, t); };
+        printf("calibrate: target %d ms, %u cores\n", target, thread::hardware_concurrency());
+        double t=timeIt(p); show(p,t);
+        for(int round=0; round<4 && fabs(t-target)>target*0.1; ++round){
+            double budget=double(p.memoryKiB)*p.passes*target/t;   // KiB x passes that fit
+            p.passes=3;
+            if(budget/3>maxKiB){ p.memoryKiB=maxKiB; p.passes=(uint32_t)ceil(budget/maxKiB); }
+            else if(budget/3<minKiB){ p.memoryKiB=minKiB; p.passes=max(1u,(uint32_t)lround(budget/minKiB)); }
+            else p.memoryKiB=(uint32_t)(budget/3);
+            p.memoryKiB=max(minKiB,p.memoryKiB/(4*p.lanes)*(4*p.lanes));
+            t=timeIt(p); show(p,t);
+        }
+        printf("KDF_MEMORY=%u\nKDF_PASSES=%u\nKDF_LANES=%u\n", p.memoryKiB, p.passes, p.lanes);
+        if(master.empty()) return 0;
+        cout.rdbuf(cerr.rdbuf());
+        SecureVault vault; vault.setVerbose(false);
+        if(!vault.auth(master)){ fprintf(stderr,"Access denied: wrong master password\n"); return 1; }
+        if(!vault.rewrap(master,p)){ fprintf(stderr,"Could not rewrap the vault key\n"); return 1; }
+        fprintf(stderr,"[Calibrate] vault key rewrapped; unlocking now takes about %.0f ms\n", t);
+        return 0;
+    }
+
+    static int rotate(int argc,char** argv){
+        string master = getenv("VAULT7_MASTER")? getenv("VAULT7_MASTER") : "";
+        string key    = getenv("VAULT7_KEY")? getenv("VAULT7_KEY") : "";
+        string next   = getenv("VAULT7_NEW_KEY")? getenv("VAULT7_NEW_KEY") : "";
+        for(int i=2;i<argc;++i){
+            string a=argv[i];
+            if(a=="--master" && i+1<argc) master=argv[++i];
+            else if(a=="--key" && i+1<argc) key=argv[++i];
+            else if(a=="--new-key" && i+1<argc) next=argv[++i];
+            else return usage();
+        }
+        if(next.empty()) return usage();
+        cout.rdbuf(cerr.rdbuf());
+        SecureVault vault; vault.setVerbose(false);
+        if(!vault.auth(master)){ fprintf(stderr,"Access denied: wrong master password\n"); return 1; }
+        if(!vault.open(SecureVault::defaultStorage())){ fprintf(stderr,"Cannot open the vault\n"); return 1; }
+        if(vault.rotating()) fprintf(stderr,"[Rotate] finishing an interrupted rotation\n");
+        string error;
+        bool first=true;
+        bool ok=vault.rotate(master,key,next,[&](size_t done,size_t total,size_t moved,double s){
+            if(first && done>moved) fprintf(stderr,"[Rotate] resumed at %zu\n", done-moved);
+            first=false;
+            fprintf(stderr,"[Rotate] %zu / %zu entries (%.0f%%), %.0f entries/s\n", done, total, 100.0*done/max<size_t>(total,1), moved/max(s,1e-9));
+        },error);
+        vault.flush();
+        if(!ok){ fprintf(stderr,"[Rotate] failed: %s\n", error.c_str()); return 1; }
+        fprintf(stderr,"[Rotate] done; entries are sealed under a new data key, use the new entry key from now on\n");
+        return 0;
+    }
+
+    // The data key sealed again under a new master password; the entries don't change.
+    static int passwd(int argc,char** argv){
+        string master = getenv("VAULT7_MASTER")? getenv("VAULT7_MASTER") : "";
+        string next   = getenv("VAULT7_NEW_MASTER")? getenv("VAULT7_NEW_MASTER") : "";
+        for(int i=2;i<argc;++i){
+            string a=argv[i];
+            if(a=="--master" && i+1<argc) master=argv[++i];
+            else if(a=="--new-master" && i+1<argc) next=argv[++i];
+            else return usage();
+        }
+        if(next.empty()) return usage();
+        cout.rdbuf(cerr.rdbuf());
+        SecureVault vault; vault.setVerbose(false);
+        bool created=!vault.hasMaster();
+        string error;
+        if(!vault.setMaster(master,next,error)){ fprintf(stderr,"[Passwd] failed: %s\n", error.c_str()); return 1; }
+        fprintf(stderr, created? "[Passwd] master password set\n" : "[Passwd] master password changed\n");
+        return 0;
+    }
+}
+
+int main(int argc,char** argv){
     using namespace std;
+    if(argc>1 && (string(argv[1])=="import" || string(argv[1])=="export")) return Cli::run(argc,argv);
+    if(argc>1 && string(argv[1])=="calibrate") return Cli::calibrate(argc,argv);
+    if(argc>1 && string(argv[1])=="rotate") return Cli::rotate(argc,argv);
+    if(argc>1 && string(argv[1])=="passwd") return Cli::passwd(argc,argv);
     App app;
     if(!app.init()){ cerr<<"Failed to initialize application\n"; return -1; }
     cout<<"The application is running. Press ESC to exit.\n";
     cout<<"Use the mouse to interact with buttons and text inputs.\n";
     cout<<"Working directory: "<<fs::absolute(".").string()<<endl;
-    cout<<"Password files: "<<fs::absolute(fs::path("vault_data")/"Passwords").string()<<endl;
-    cout<<"Backup files:   "<<fs::absolute(fs::path("vault_data")/"BackupCodes").string()<<endl;
-    cout<<"Notes files:    "<<fs::absolute(fs::path("vault_data")/"Notes").string()<<endl;
+    for(auto& s: schemas) cout<<s.menu<<" files: "<<fs::absolute(fs::path("vault_data")/s.dir).string()<<endl;
     app.run(); app.shutdown();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,2124 @@
+// Vault_7 storage core: secure memory, entry encryption, the entry model, entry files,
+// vault log and image, persistence, the vault itself and the unlocked session.
+// Header-only and free of GL, so the app, the benchmarks and the tests share it.
+#pragma once
+
+#include <bits/stdc++.h>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define NOGDI
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <bcrypt.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "vault_crypto.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// ---------- SECURE MEMORY ----------
+// Decrypted secrets live in a locked arena instead of the general heap. Chunks are mlock'd
+// (VirtualLock on Windows) so they stay out of swap, and on Linux they are left out of
+// core dumps. Each chunk is split into blocks of one size class (32 B .. 4 KiB), which are
+// kept on free lists. Blocks are wiped when released. Bigger secrets get a locked mapping
+// of their own. If locking fails (RLIMIT_MEMLOCK) the memory is still used, but counted.
+class SecureArena {
+public:
+    struct Stats { size_t allocs, frees, live, peak, chunks, mappedBytes, lockFailures, large; };
+    static SecureArena& get(){ static SecureArena a; return a; }
+    void* allocate(size_t n){
+        lock_guard<mutex> g(mu);
+        ++st.allocs; st.live+=n; st.peak=max(st.peak,st.live);
+        int c=sizeClass(n);
+        if(c<0){ ++st.large; return map(pageRound(n)); }
+        if(!freeList[c]){
+            char* chunk=(char*)map(CHUNK); size_t b=MIN<<c;
+            ++st.chunks;
+            for(size_t off=CHUNK; off>=b; off-=b) push(c,chunk+off-b);
+        }
+        void* p=freeList[c]; freeList[c]=*(void**)p; *(void**)p=nullptr;
+        return p;
+    }
+    void release(void* p,size_t n){
+        if(!p) return;
+        int c=sizeClass(n);
+        VaultCrypto::wipe(p, c<0? pageRound(n) : MIN<<c);
+        lock_guard<mutex> g(mu);
+        ++st.frees; st.live-=n;
+        if(c<0) unmap(p,pageRound(n)); else push(c,p);
+    }
+    Stats stats(){ lock_guard<mutex> g(mu); return st; }
+    // What allocate(n) really hands out, so callers can grow into the whole block.
+    static size_t blockSize(size_t n){ int c=sizeClass(n); return c<0? pageRound(n) : MIN<<c; }
+private:
+    static constexpr size_t MIN=32, CLASSES=8, CHUNK=16*1024;   // blocks of 32 B .. 4 KiB
+    mutex mu; void* freeList[CLASSES]={}; Stats st={};
+    static int sizeClass(size_t n){ int c=0; while((MIN<<c)<n){ if(++c==(int)CLASSES) return -1; } return c; }
+    static size_t pageRound(size_t n){ return (n+4095)&~size_t(4095); }
+    void push(int c,void* p){ *(void**)p=freeList[c]; freeList[c]=p; }
+    void* map(size_t n){
+        st.mappedBytes+=n;
+#ifdef _WIN32
+        void* p=VirtualAlloc(nullptr,n,MEM_COMMIT|MEM_RESERVE,PAGE_READWRITE);
+        if(!p) throw bad_alloc();
+        if(!VirtualLock(p,n)) ++st.lockFailures;
+#else
+        void* p=mmap(nullptr,n,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+        if(p==MAP_FAILED) throw bad_alloc();
+        if(mlock(p,n)!=0) ++st.lockFailures;
+#ifdef MADV_DONTDUMP
+        madvise(p,n,MADV_DONTDUMP);
+#endif
+#endif
+        return p;
+    }
+    void unmap(void* p,size_t n){
+        st.mappedBytes-=n;
+#ifdef _WIN32
+        VirtualUnlock(p,n); VirtualFree(p,0,MEM_RELEASE);
+#else
+        munlock(p,n); munmap(p,n);
+#endif
+    }
+};
+
+// A plaintext secret in the arena. The bytes are always out of line, so no small-string
+// copy is left in ordinary memory. They are NUL-terminated for the text renderer and
+// wiped when the secret is freed, cleared or given a new value.
+class Secret {
+    char* p=nullptr; size_t n=0, cap=0;
+    void release(){ SecureArena::get().release(p,cap); p=nullptr; n=cap=0; }
+public:
+    Secret()=default;
+    Secret(string_view s){ assign(s); }
+    Secret(const string& s):Secret(string_view(s)){}
+    Secret(const char* s):Secret(string_view(s)){}
+    Secret(const Secret& o){ assign(o.view()); }
+    Secret(Secret&& o) noexcept :p(o.p),n(o.n),cap(o.cap){ o.p=nullptr; o.n=o.cap=0; }
+    Secret& operator=(const Secret& o){ if(this!=&o) assign(o.view()); return *this; }
+    Secret& operator=(Secret&& o) noexcept { if(this!=&o){ release(); p=o.p; n=o.n; cap=o.cap; o.p=nullptr; o.n=o.cap=0; } return *this; }
+    ~Secret(){ release(); }
+    // m bytes (zeroed) to be filled in place; the old contents are wiped, not kept.
+    char* reset(size_t m){
+        if(m+1>cap){ release(); cap=SecureArena::blockSize(m+1); p=(char*)SecureArena::get().allocate(cap); }
+        else VaultCrypto::wipe(p,n);
+        n=m; p[n]=0; return p;
+    }
+    void assign(string_view s){ if(s.data()>=p && s.data()<p+cap){ Secret t(s); *this=std::move(t); return; } memcpy(reset(s.size()),s.data(),s.size()); }
+    void clear(){ if(p){ VaultCrypto::wipe(p,n); n=0; p[0]=0; } }
+    size_t size() const { return n; }
+    bool empty() const { return n==0; }
+    const char* data() const { return p? p : ""; }
+    const char* c_str() const { return data(); }
+    string_view view() const { return string_view(data(),n); }
+    operator string_view() const { return view(); }
+    string str() const { return string(view()); }   // for ordinary string APIs; the copy is not wiped
+    bool operator==(string_view o) const { return view()==o; }
+};
+
+// ---------- ENTRY ENCRYPTION ----------
+// Secret fields are sealed with the vault's AEAD suite as "$A$" (AES-256-GCM) or "$C$"
+// (ChaCha20-Poly1305) + base64(nonce | ciphertext | tag). The associated data is the
+// entry type, id and field name, so a sealed value pasted into another entry or field
+// fails to open. The nonce is an HMAC of that context and the
+// plaintext (synthetic IV): an unchanged secret reseals to the same bytes, which keeps the
+// persistence queue's skip-unchanged check and the watcher's echo check working.
+static const char* b64chars="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static string base64(const uint8_t* p,size_t n){
+    string o; o.reserve((n+2)/3*4);
+    for(size_t i=0;i<n;i+=3){
+        uint32_t v=uint32_t(p[i])<<16 | (i+1<n? uint32_t(p[i+1])<<8 : 0) | (i+2<n? p[i+2] : 0);
+        o.push_back(b64chars[v>>18]); o.push_back(b64chars[v>>12&63]);
+        o.push_back(i+1<n? b64chars[v>>6&63] : '='); o.push_back(i+2<n? b64chars[v&63] : '=');
+    }
+    return o;
+}
+static bool unbase64(string_view s,string& out){
+    static const auto table=[]{ array<int8_t,256> t; t.fill(-1); for(int i=0;i<64;++i) t[(unsigned char)b64chars[i]]=(int8_t)i; return t; }();
+    if(s.size()%4) return false;
+    out.clear(); out.reserve(s.size()/4*3);
+    for(size_t i=0;i<s.size();i+=4){
+        int pad = s[i+3]=='='? (s[i+2]=='='? 2 : 1) : 0;
+        if(pad && i+4!=s.size()) return false;
+        uint32_t v=0;
+        for(int k=0;k<4-pad;++k){ int8_t d=table[(unsigned char)s[i+k]]; if(d<0) return false; v|=uint32_t(d)<<(18-6*k); }
+        out.push_back(char(v>>16)); if(pad<2) out.push_back(char(v>>8&0xFF)); if(pad<1) out.push_back(char(v&0xFF));
+    }
+    return true;
+}
+// The pre-AES format (every byte ^3, then "!@"); still read, never written.
+static string xorDec(string_view s){ if(s.size()<2) return {}; string r(s.substr(0,s.size()-2)); for(char& c:r) c^=3; return r; }
+
+class FieldCipher {
+public:
+    enum Suite : uint8_t { AES_GCM, CHACHA20_POLY1305 };
+    static const char* suiteName(Suite s){ return s==AES_GCM? "aes-256-gcm" : "chacha20-poly1305"; }
+    static bool parseSuite(string_view name,Suite& s){
+        if(name=="aes-256-gcm" || name=="aes") s=AES_GCM;
+        else if(name=="chacha20-poly1305" || name=="chacha") s=CHACHA20_POLY1305;
+        else return false;
+        return true;
+    }
+    // AES-GCM where AES-NI makes it the faster one, ChaCha20-Poly1305 everywhere else.
+    static Suite preferred(){ return VaultCrypto::AesGcm::hardwareAvailable()? AES_GCM : CHACHA20_POLY1305; }
+
+    // allowHardware=false forces the portable AES and scalar ChaCha20 code (benchmarks).
+    explicit FieldCipher(const string& secret,bool allowHardware=true){ rekey(secret,allowHardware); }
+    ~FieldCipher(){ VaultCrypto::wipe(nonceKey,sizeof(nonceKey)); }
+    // Switches to another data key; nothing may be sealing or opening meanwhile.
+    void rekey(const string& secret,bool allowHardware=true){
+        uint8_t k[32];
+        derive(secret,"vault7 entry key",k);
+        aeads[AES_GCM]=make_unique<VaultCrypto::AesGcm>(k,allowHardware);
+        derive(secret,"vault7 entry key chacha20-poly1305",k);
+        aeads[CHACHA20_POLY1305]=make_unique<VaultCrypto::ChaCha20Poly1305>(k,allowHardware? VaultCrypto::ChaCha20Poly1305::best() : VaultCrypto::ChaCha20Poly1305::Kernel::Scalar);
+        derive(secret,"vault7 nonce key",nonceKey);
+        VaultCrypto::wipe(k,sizeof(k));
+    }
+    // Suite new values are sealed with; values under either suite always open.
+    void use(Suite s){ writeSuite=s; }
+    Suite suite() const { return writeSuite; }
+    const VaultCrypto::Aead& aead(Suite s) const { return *aeads[s]; }
+    static bool isSealed(string_view v){ return v.size()>=3 && v[0]=='$' && (v[1]=='A' || v[1]=='C') && v[2]=='$'; }
+
+    string seal(string_view plain,string_view aad) const {
+        using VaultCrypto::Aead;
+        Suite s=writeSuite;
+        uint8_t mac[32]; uint8_t alen[8]; VaultCrypto::store64be(alen,aad.size());
+        VaultCrypto::HmacSha256(nonceKey,sizeof(nonceKey)).update(alen,8).update(aad.data(),aad.size()).update(plain.data(),plain.size()).final(mac);
+        vector<uint8_t> raw(Aead::NONCE+plain.size()+Aead::TAG);
+        memcpy(raw.data(),mac,Aead::NONCE);
+        uint8_t* ct=raw.data()+Aead::NONCE;
+        aeads[s]->seal(raw.data(),(const uint8_t*)aad.data(),aad.size(),(const uint8_t*)plain.data(),plain.size(),ct,ct+plain.size());
+        return (s==AES_GCM? "$A$" : "$C$")+base64(raw.data(),raw.size());
+    }
+    // false if the value is malformed or fails authentication (wrong key, tampered, moved).
+    bool open(string_view sealed,string_view aad,string& plain,bool* current=nullptr) const {
+        plain.resize(openedSize(sealed));
+        bool ok=open(sealed,aad,&plain[0],current);
+        if(!ok) plain.clear();
+        return ok;
+    }
+    bool open(string_view sealed,string_view aad,Secret& plain,bool* current=nullptr) const {
+        bool ok=open(sealed,aad,plain.reset(openedSize(sealed)),current);
+        if(!ok) plain.clear();
+        return ok;
+    }
+    // Plaintext length of a sealed value (0 when malformed), so a batch can lay out its
+    // output before opening anything.
+    static size_t openedSize(string_view sealed){
+        using VaultCrypto::Aead;
+        if(!isSealed(sealed) || (sealed.size()-3)%4) return 0;
+        size_t raw=(sealed.size()-3)/4*3 - (sealed.size()>3 && sealed.back()=='='? (sealed[sealed.size()-2]=='='? 2 : 1) : 0);
+        return raw>=Aead::NONCE+Aead::TAG? raw-Aead::NONCE-Aead::TAG : 0;
+    }
+    // Opens into out, which holds openedSize(sealed) bytes; nothing is allocated once the
+    // calling thread's scratch buffer has grown. current tells whether sealing the plaintext
+    // again would give back the same value (this key and the write suite).
+    bool open(string_view sealed,string_view aad,char* out,bool* current=nullptr) const {
+        bool ok=openHere(sealed,aad,out);
+        if(current) *current = ok && (sealed[1]=='A')==(writeSuite==AES_GCM);
+        if(!ok && retired) ok=retired->open(sealed,aad,out);
+        return ok;
+    }
+    // Whether the value opens under this key alone; a rotation may drop the retired key
+    // once this holds for every value that still opens at all.
+    bool opensWithoutRetired(string_view sealed,string_view aad) const {
+        Secret p; return openHere(sealed,aad,p.reset(openedSize(sealed)));
+    }
+    // While a key rotation runs, values not yet moved open under the old key; everything
+    // is sealed under the new one.
+    void retire(const string& oldSecret){ retired=make_unique<FieldCipher>(oldSecret); }
+    void dropRetired(){ retired.reset(); }
+private:
+    unique_ptr<VaultCrypto::Aead> aeads[2];
+    unique_ptr<FieldCipher> retired;
+    uint8_t nonceKey[32];
+    atomic<Suite> writeSuite{preferred()};
+    bool openHere(string_view sealed,string_view aad,char* out) const {
+        using VaultCrypto::Aead;
+        thread_local string raw;
+        if(!isSealed(sealed) || !unbase64(sealed.substr(3),raw) || raw.size()<Aead::NONCE+Aead::TAG) return false;
+        size_t n=raw.size()-Aead::NONCE-Aead::TAG;
+        const uint8_t* r=(const uint8_t*)raw.data();
+        bool ok=aeads[sealed[1]=='A'? AES_GCM : CHACHA20_POLY1305]->open(r,(const uint8_t*)aad.data(),aad.size(),r+Aead::NONCE,n,r+Aead::NONCE+n,(uint8_t*)out);
+        VaultCrypto::wipe(&raw[0],raw.size());
+        return ok;
+    }
+    static void derive(const string& secret,const char* label,uint8_t out[32]){ VaultCrypto::HmacSha256(secret.data(),secret.size()).update(label,strlen(label)).final(out); }
+};
+// Keyed with the vault's data key at unlock (SecureVault::auth) and set to the header's
+// suite at open. Until then it holds the fixed key vaults used before key derivation.
+static FieldCipher& entryCipher(){ static FieldCipher c("turndownforwhat"); return c; }
+static string fieldAad(char type,const string& id,const char* field){ return string(1,type)+'\x1f'+id+'\x1f'+field; }
+static void fieldAad(string& out,char type,string_view id,const char* field){ out.assign(1,type).append(1,'\x1f').append(id).append(1,'\x1f').append(field); }
+static string sealField(char type,const string& id,const char* field,string_view plain){ return entryCipher().seal(plain,fieldAad(type,id,field)); }
+// Sealed values are authenticated; anything else is taken as the old xor format.
+static bool openField(char type,const string& id,const char* field,string_view v,Secret& plain){
+    if(!FieldCipher::isSealed(v)){ string t=xorDec(v); plain.assign(t); VaultCrypto::wipe(&t[0],t.size()); return true; }
+    return entryCipher().open(v,fieldAad(type,id,field),plain);
+}
+// A value read from disk in sealed form, upgrading the old format on the way in.
+static string resealField(char type,const string& id,const char* field,string_view v){
+    return FieldCipher::isSealed(v)? string(v) : sealField(type,id,field,xorDec(v));
+}
+static const pair<string,string> authError{"Error", "Entry failed authentication."};
+
+// The entry key (the "decryption key" of the detail views) is never stored: the header
+// keeps an HMAC of it under the data key. Until a vault is unlocked only the built-in key
+// passes, as it did before key derivation.
+class EntryKey {
+public:
+    static string check(const string& dataKey,const string& k){
+        uint8_t mac[32]; VaultCrypto::HmacSha256(dataKey.data(),dataKey.size()).update("vault7 entry key check",22).update(k.data(),k.size()).final(mac);
+        return base64(mac,sizeof(mac));
+    }
+    ~EntryKey(){ VaultCrypto::wipe(&dataKey[0],dataKey.size()); }
+    void set(const string& dk,const string& chk){ VaultCrypto::wipe(&dataKey[0],dataKey.size()); dataKey=dk; expected=chk; }
+    bool valid(const string& k) const {
+        if(expected.empty() || dataKey.empty()) return k=="turndownforwhat";
+        string c=check(dataKey,k);
+        return c.size()==expected.size() && VaultCrypto::equal((const uint8_t*)c.data(),(const uint8_t*)expected.data(),c.size());
+    }
+private:
+    string dataKey, expected;
+};
+static EntryKey& entryKey(){ static EntryKey k; return k; }
+
+// ---------- DATA MODEL ----------
+// Entry categories. Every entry carries its tag, and the vault keeps one container per
+// tag; the letter is what entry files, log records and the associated data use.
+enum class EntryType : uint8_t { Password, BackupCode, QuickNote, TotpSeed, SshKey, PaymentCard };
+constexpr size_t ENTRY_TYPES=6;
+constexpr char typeLetter(EntryType t){ return "PBNTSC"[size_t(t)]; }
+// nullopt for a letter no type has (a damaged record, or one from a newer build)
+constexpr optional<EntryType> typeOfLetter(char c){ for(size_t t=0;t<ENTRY_TYPES;++t) if(typeLetter(EntryType(t))==c) return EntryType(t); return nullopt; }
+
+// ---------- ENTRY SCHEMAS ----------
+// An entry type is a fixed list of fields: the identifier first (in the clear, it names the
+// entry file), then one or two values. SchemaEntry<T> below is the entry class generated
+// from it, and the vault, command line and UI read everything else (entry file keys,
+// directories, rows, inputs, limits) from the same table, so a new type is one more row.
+struct FieldSpec {
+    enum : uint8_t { CLEAR_ON_DISK=1, MASKED=2 };
+    const char* key;     // KEY= in entry files and log records
+    const char* label;   // rows and inputs; also part of a sealed value's associated data
+    bool secret;         // held sealed, opened only to be viewed
+    uint32_t maxLen;     // longest value accepted (0: any)
+    uint8_t flags=0;     // CLEAR_ON_DISK: secret but written unsealed (backup usernames always were);
+                         // MASKED: the sealed row shows as [ENCRYPTED]
+    bool sealedOnDisk() const { return secret && !(flags&CLEAR_ON_DISK); }
+    // Lines in the clear are KEY=VALUE, so they can't hold a line break; sealed ones are base64.
+    bool accepts(string_view v) const { return (!maxLen || v.size()<=maxLen) && (sealedOnDisk() || v.find_first_of("\r\n")==string_view::npos); }
+};
+constexpr size_t MAX_FIELDS=3;
+constexpr size_t MAX_VALUES=MAX_FIELDS-1;   // fields after the identifier: sizes every per-entry value array
+struct EntrySchema {
+    EntryType type;
+    const char* name;          // getType(), rotation order
+    const char* cli;           // type column of import/export
+    const char* dir;           // vault_data/<dir>
+    const char* tag;           // log lines
+    const char* filePrefix;    // entry file name before the encoded identifier
+    const char* titlePrefix;   // list row and detail title before the identifier
+    const char* menu;          // main menu button
+    const char* heading;       // list view heading
+    const char* noun;          // status messages
+    bool numbered;             // identifier is the next serial number, never typed in
+    size_t n; array<FieldSpec,MAX_FIELDS> fields;
+};
+constexpr EntrySchema schemas[ENTRY_TYPES]={
+    {EntryType::Password,"Password","password","Passwords","PW","","","Passwords","Select a Password Entry","Password site",false,
+     3,{{ {"SERVICE","Service",false,0}, {"USERNAME","Username",false,0}, {"PASSWORD","Password",true,0} }}},
+    {EntryType::BackupCode,"BackupCode","backup","BackupCodes","BC","","","Backup Codes","Select a Backup Code Entry","Backup site",false,
+     3,{{ {"ACCOUNT","Account",false,0}, {"USERNAME","Username",true,0,FieldSpec::CLEAR_ON_DISK}, {"CODE","Backup Code",true,0} }}},
+    {EntryType::QuickNote,"QuickNote","note","Notes","NT","note_","Note ","Nuclear Launch Codes","QUICK NOTES - NUCLEAR LAUNCH CODES","Note",true,
+     2,{{ {"NOTE_ID","Note",false,0}, {"TEXT","Text",true,0,FieldSpec::MASKED} }}},
+    {EntryType::TotpSeed,"TotpSeed","totp","TotpSeeds","TP","","","TOTP Seeds","Select a TOTP Seed","TOTP seed",false,
+     3,{{ {"ISSUER","Issuer",false,256}, {"ACCOUNT","Account",false,256}, {"SEED","Seed",true,128} }}},
+    {EntryType::SshKey,"SshKey","ssh","SshKeys","SK","","","SSH Keys","Select an SSH Key","SSH key",false,
+     3,{{ {"HOST","Host",false,256}, {"USERNAME","Username",false,256}, {"KEY","Private Key",true,16384} }}},
+    {EntryType::PaymentCard,"PaymentCard","card","PaymentCards","PC","","","Payment Cards","Select a Payment Card","Payment card",false,
+     3,{{ {"CARD","Card",false,256}, {"HOLDER","Cardholder",false,256}, {"NUMBER","Card Number",true,23} }}},
+};
+constexpr bool schemasValid(){
+    for(size_t t=0;t<ENTRY_TYPES;++t){
+        const EntrySchema& s=schemas[t];
+        if(size_t(s.type)!=t || s.n<2 || s.n>MAX_FIELDS || s.fields[0].secret) return false;
+        for(size_t u=0;u<t;++u) if(typeLetter(schemas[u].type)==typeLetter(s.type)) return false;
+    }
+    return true;
+}
+static_assert(schemasValid(), "schemas: one per EntryType, in order; identifier in the clear, 1..MAX_VALUES values");
+constexpr const EntrySchema& schemaOf(EntryType t){ return schemas[size_t(t)]; }
+static const char* entryTypeName(EntryType t){ return schemaOf(t).name; }
+
+class SensitiveData {
+public:
+    virtual ~SensitiveData() {}
+    EntryType type() const { return tag; }    // no virtual call, no string
+    string getType() const { return entryTypeName(tag); }   // EntrySchema::name
+    virtual string getIdentifier() const = 0; // key (service/account/note id)
+    // Display name on list and detail title: the identifier behind this prefix.
+    static string_view titlePrefix(EntryType t){ return schemaOf(t).titlePrefix; }
+    string getTitle() const { return string(titlePrefix(tag))+getIdentifier(); }
+    // New values for the secret fields, in field order (checked against the entry key).
+    virtual void edit(const string& key,const vector<string_view>& values) = 0;
+    // The values after the identifier, as held: sealed or plain. Returns how many were
+    // filled, 0 if the entry could not be read. For batch decryption.
+    struct Field { const char* label; string_view value; bool sealed; };
+    virtual int storedFields(Field out[MAX_VALUES]) const = 0;
+
+    // Rows of the detail view, by value and without heap memory: labels are static and
+    // values view the entry's own storage (encryptedRows) or the caller's buffer.
+    struct RowView { string_view label, value; };
+    struct RowSet {
+        RowView at[MAX_VALUES]; int n=0; bool ok=true;   // !ok: one "Error" row with a static message
+        const RowView* begin() const { return at; }
+        const RowView* end() const { return at+n; }
+    };
+    static RowSet errorRows(string_view msg){ RowSet r; r.ok=false; r.n=1; r.at[0]={"Error",msg}; return r; }
+    virtual RowSet encryptedRows() const = 0;                 // rows to show initially
+    // Rows after a valid key, opened into buf (secure arena, reused across calls).
+    RowSet decryptedRows(const string& key,Secret& buf) const {
+        if(!entryKey().valid(key)) return errorRows("Invalid decryption key.");
+        Field f[MAX_VALUES]; int n=storedFields(f);
+        if(!n) return errorRows("Entry could not be read.");
+        size_t len[MAX_VALUES], total=0;
+        for(int j=0;j<n;++j) total+=len[j]= f[j].sealed? FieldCipher::openedSize(f[j].value) : f[j].value.size();
+        char* d=buf.reset(total); string id=getIdentifier(); thread_local string aad;
+        RowSet r; r.n=n;
+        for(int j=0;j<n;++j){
+            if(!f[j].sealed) memcpy(d,f[j].value.data(),len[j]);
+            else { fieldAad(aad,typeLetter(tag),id,f[j].label); if(!entryCipher().open(f[j].value,aad,d)){ buf.clear(); return errorRows(authError.second); } }
+            r.at[j]={f[j].label,string_view(d,len[j])}; d+=len[j];
+        }
+        return r;
+    }
+protected:
+    explicit SensitiveData(EntryType t):tag(t){}
+private:
+    EntryType tag;
+};
+
+// An entry's strings in one allocation, each behind its 32-bit length, instead of a
+// std::string apiece: 8 bytes in the object and one block on the heap.
+template<size_t N> class Packed {
+    unique_ptr<char[]> p;
+public:
+    Packed()=default;
+    Packed(const array<string_view,N>& v){ assign(v); }
+    void assign(const array<string_view,N>& v){
+        size_t total=0; for(auto x: v) total+=4+x.size();
+        unique_ptr<char[]> q(new char[total]); char* d=q.get();
+        for(auto x: v){ uint32_t l=(uint32_t)x.size(); memcpy(d,&l,4); memcpy(d+4,x.data(),l); d+=4+l; }
+        p=std::move(q);   // the old block goes only after v (which may point into it) is copied
+    }
+    string_view operator[](size_t i) const {
+        const char* d=p.get(); uint32_t l;
+        for(;;){ memcpy(&l,d,4); if(!i--) return string_view(d+4,l); d+=4+l; }
+    }
+    array<string_view,N> views() const { array<string_view,N> v; for(size_t i=0;i<N;++i) v[i]=(*this)[i]; return v; }
+    void set(size_t i,string_view x){ auto v=views(); v[i]=x; assign(v); }
+    size_t bytes() const { size_t n=0; for(auto x: views()) n+=4+x.size(); return n; }
+};
+
+// The entry class of one schema. It holds the identifier and the values packed in field
+// order, secret ones only as ciphertext (associated data: type, identifier, field label);
+// a value is opened into the caller's buffer when it is viewed.
+template<EntryType T> class SchemaEntry : public SensitiveData {
+public:
+    static constexpr const EntrySchema& S=schemas[size_t(T)];
+    static constexpr size_t N=S.n;
+    using Values=array<string_view,N>;   // identifier first
+    // From plaintext values.
+    explicit SchemaEntry(const Values& v):SensitiveData(T){ hold(v,false); }
+    template<class... V,class=enable_if_t<sizeof...(V)==N>> explicit SchemaEntry(const V&... v):SchemaEntry(Values{string_view(v)...}){}
+    // From a stored entry, values as written there (the old sealed format is upgraded).
+    static unique_ptr<SchemaEntry> fromStored(const Values& v){ unique_ptr<SchemaEntry> r(new SchemaEntry); r->hold(v,true); return r; }
+
+    string getIdentifier() const override { return string(f[0]); }
+    RowSet encryptedRows() const override {
+        RowSet r; r.n=int(N-1);
+        for(size_t i=1;i<N;++i) r.at[i-1]={S.fields[i].label, S.fields[i].flags&FieldSpec::MASKED? string_view("[ENCRYPTED]") : f[i]};
+        return r;
+    }
+    void edit(const string& key,const vector<string_view>& values) override {
+        if(!entryKey().valid(key)) return;
+        string id(f[0]); Values v=f.views(); array<string,N> sealed; size_t k=0;
+        for(size_t i=1;i<N;++i) if(S.fields[i].secret){ sealed[i]=sealField(typeLetter(T),id,S.fields[i].label,k<values.size()? values[k] : string_view()); v[i]=sealed[i]; ++k; }
+        f.assign(v);
+    }
+    int storedFields(Field out[MAX_VALUES]) const override { for(size_t i=1;i<N;++i) out[i-1]={S.fields[i].label,f[i],S.fields[i].secret}; return int(N-1); }
+private:
+    Packed<N> f;
+    SchemaEntry():SensitiveData(T){}
+    void hold(const Values& v,bool stored){
+        string id(v[0]); array<string,N> sealed; Values h=v;
+        for(size_t i=1;i<N;++i){
+            const FieldSpec& d=S.fields[i];
+            if(!d.secret) continue;
+            sealed[i] = stored && d.sealedOnDisk()? resealField(typeLetter(T),id,d.label,v[i]) : sealField(typeLetter(T),id,d.label,v[i]);
+            h[i]=sealed[i];
+        }
+        f.assign(h);
+    }
+};
+using Password=SchemaEntry<EntryType::Password>;
+using BackupCode=SchemaEntry<EntryType::BackupCode>;
+using QuickNote=SchemaEntry<EntryType::QuickNote>;
+using TotpSeed=SchemaEntry<EntryType::TotpSeed>;
+using SshKey=SchemaEntry<EntryType::SshKey>;
+using PaymentCard=SchemaEntry<EntryType::PaymentCard>;
+
+// Any type's entry from schemaOf(type).n values, identifier first; stored: as written in
+// an entry file or log record, otherwise plaintext. Indexed by EntryType.
+using EntryBuilder=unique_ptr<SensitiveData>(*)(const string_view*,bool);
+template<EntryType T> static unique_ptr<SensitiveData> buildEntry(const string_view* v,bool stored){
+    typename SchemaEntry<T>::Values a; copy(v,v+a.size(),a.begin());
+    if(stored) return SchemaEntry<T>::fromStored(a);
+    return make_unique<SchemaEntry<T>>(a);
+}
+template<size_t... I> constexpr array<EntryBuilder,ENTRY_TYPES> entryBuilders(index_sequence<I...>){ return {{ buildEntry<EntryType(I)>... }}; }
+constexpr array<EntryBuilder,ENTRY_TYPES> entryBuilder=entryBuilders(make_index_sequence<ENTRY_TYPES>());
+
+// Entry known only by type and identifier (from a file name or the image index) until
+// something needs its rows; the first such call runs the loader, later ones forward.
+class LazyEntry : public SensitiveData {
+    string ident;
+    mutable function<unique_ptr<SensitiveData>()> load;
+    mutable unique_ptr<SensitiveData> real;
+    SensitiveData* get() const { if(load){ real=load(); load=nullptr; } return real.get(); }
+public:
+    LazyEntry(EntryType t,string id,function<unique_ptr<SensitiveData>()> f):SensitiveData(t),ident(std::move(id)),load(std::move(f)){}
+    string getIdentifier() const override { return ident; }
+    RowSet encryptedRows() const override { if(auto* r=get()) return r->encryptedRows(); return errorRows("Entry could not be read."); }
+    void edit(const string& key,const vector<string_view>& values) override { if(auto* r=get()) r->edit(key,values); }
+    int storedFields(Field out[MAX_VALUES]) const override { if(auto* r=get()) return r->storedFields(out); return 0; }
+    bool loaded() const { return !load; }
+};
+
+// ---------- STORAGE HELPERS ----------
+// One schema's KEY=VALUE fields of an entry file/record, in field order, as views into the
+// caller's buffer. Unknown keys are skipped, the last occurrence of a key wins, CRLF files are fine.
+struct EntryFields {
+    string_view v[MAX_FIELDS];
+    void parse(string_view buf,const EntrySchema& s){
+        *this = EntryFields{};
+        while(!buf.empty()){
+            size_t nl=buf.find('\n');
+            string_view line=buf.substr(0,nl);
+            buf = nl==string_view::npos? string_view{} : buf.substr(nl+1);
+            if(!line.empty() && line.back()=='\r') line.remove_suffix(1);
+            size_t eq=line.find('='); if(eq==string_view::npos) continue;
+            string_view k=line.substr(0,eq);
+            for(size_t i=0;i<s.n;++i) if(k==s.fields[i].key){ v[i]=line.substr(eq+1); break; }
+        }
+    }
+};
+// Whole file into buf, reusing its capacity; false if it can't be read.
+static bool readInto(const fs::path& p,string& buf){
+    ifstream f(p, ios::binary|ios::ate); if(!f) return false;
+    streamoff n=f.tellg(); if(n<0) return false;
+    buf.resize((size_t)n); f.seekg(0);
+    return (bool)f.read(buf.data(), n);
+}
+static uint32_t fnv1a(const char* p,size_t n,uint32_t h=2166136261u){ for(size_t i=0;i<n;++i){ h^=(unsigned char)p[i]; h*=16777619u; } return h; }
+// File name for an identifier that is unique even on case-insensitive file systems:
+// [a-z0-9_-] as is, uppercase X as ^X, every other byte as %XX. Windows device names get
+// their first byte escaped; overlong names are cut and tagged with a hash of the full id.
+static string entryFileName(const string& id){
+    static const char* hex="0123456789ABCDEF";
+    string o; o.reserve(id.size()+8);
+    for(unsigned char c: id){
+        if((c>='a'&&c<='z')||(c>='0'&&c<='9')||c=='_'||c=='-') o.push_back((char)c);
+        else if(c>='A'&&c<='Z'){ o.push_back('^'); o.push_back((char)c); }
+        else { o.push_back('%'); o.push_back(hex[c>>4]); o.push_back(hex[c&15]); }
+    }
+    static const char* reserved[]={"con","prn","aux","nul","com1","com2","com3","com4","com5","com6","com7","com8","com9","lpt1","lpt2","lpt3","lpt4","lpt5","lpt6","lpt7","lpt8","lpt9"};
+    for(const char* r: reserved) if(o==r){ o="%"+string(1,hex[(unsigned char)o[0]>>4])+string(1,hex[o[0]&15])+o.substr(1); break; }
+    if(o.size()>200){ char h[20]; snprintf(h,sizeof(h),"~%08x%08x",fnv1a(id.data(),id.size()),fnv1a(id.data(),id.size(),0x811c9dc5u^0x5bd1e995u)); o=o.substr(0,180)+h; }
+    if(o.empty()) o="%00";
+    return o;
+}
+// Inverse of entryFileName; false for names it would not produce (truncated, old layout).
+static bool entryIdFromFileName(string_view name,string& id){
+    id.clear();
+    for(size_t i=0;i<name.size();++i){
+        char c=name[i];
+        if(c=='^'){ if(++i>=name.size()) return false; id.push_back(name[i]); }
+        else if(c=='%'){
+            if(i+2>=name.size()) return false;
+            auto hv=[](char h){ return h>='0'&&h<='9'? h-'0' : h>='A'&&h<='F'? h-'A'+10 : -1; };
+            int a=hv(name[i+1]), b=hv(name[i+2]); if(a<0||b<0) return false;
+            id.push_back((char)(a*16+b)); i+=2;
+        } else id.push_back(c);
+    }
+    return name!="%00" && entryFileName(id)==name;
+}
+// One of 256 subdirectories ("00".."ff") so no directory grows past n/256 entries.
+static string shardOf(const string& id){ char b[3]; snprintf(b,sizeof(b),"%02x",fnv1a(id.data(),id.size())&0xFF); return b; }
+static bool isShardDir(const fs::path& d){ string n=d.filename().string(); return n.size()==2 && isxdigit((unsigned char)n[0]) && isxdigit((unsigned char)n[1]); }
+static void putU32(string& o,uint32_t v){ for(int i=0;i<4;++i) o.push_back(char((v>>(8*i))&0xFF)); }
+static uint32_t getU32(const char* p){ uint32_t v=0; for(int i=0;i<4;++i) v|=uint32_t((unsigned char)p[i])<<(8*i); return v; }
+static string readFile(const fs::path& p){ ifstream f(p, ios::binary); if(!f) return {}; return string(istreambuf_iterator<char>(f), {}); }
+
+// ---------- DURABLE FILE I/O ----------
+#ifdef _WIN32
+static int sysOpen(const fs::path& p,int flags){ return _wopen(p.c_str(), flags|_O_BINARY, _S_IREAD|_S_IWRITE); }
+static long sysWrite(int fd,const char* p,size_t n){ return _write(fd,p,(unsigned)min<size_t>(n,1u<<30)); }
+static bool sysSync(int fd){ return _commit(fd)==0; }
+static void sysClose(int fd){ _close(fd); }
+static void syncDir(const fs::path&){}   // NTFS metadata is journaled; no directory handle to flush
+static bool sysRandom(void* p,size_t n){ return BCRYPT_SUCCESS(BCryptGenRandom(nullptr,(PUCHAR)p,(ULONG)n,BCRYPT_USE_SYSTEM_PREFERRED_RNG)); }
+#else
+static int sysOpen(const fs::path& p,int flags){ return ::open(p.c_str(), flags|O_CLOEXEC, 0600); }
+static long sysWrite(int fd,const char* p,size_t n){ return (long)::write(fd,p,n); }
+static bool sysSync(int fd){ return ::fsync(fd)==0; }
+static void sysClose(int fd){ ::close(fd); }
+static void syncDir(const fs::path& d){ int fd=::open(d.empty()? "." : d.c_str(), O_RDONLY|O_CLOEXEC); if(fd>=0){ ::fsync(fd); ::close(fd); } }
+static bool sysRandom(void* p,size_t n){
+    int fd=::open("/dev/urandom", O_RDONLY|O_CLOEXEC); if(fd<0) return false;
+    char* b=(char*)p; bool ok=true;
+    while(ok && n){ ssize_t r=::read(fd,b,n); if(r<=0) ok=false; else { b+=r; n-=(size_t)r; } }
+    ::close(fd); return ok;
+}
+#endif
+static bool writeFileSynced(const fs::path& p,const string& data,bool sync){
+    int fd=sysOpen(p, O_WRONLY|O_CREAT|O_TRUNC); if(fd<0) return false;
+    size_t off=0; bool ok=true;
+    while(ok && off<data.size()){ long n=sysWrite(fd,data.data()+off,data.size()-off); if(n<=0) ok=false; else off+=(size_t)n; }
+    if(ok && sync) ok=sysSync(fd);
+    sysClose(fd); return ok;
+}
+static bool syncFile(const fs::path& p){ int fd=sysOpen(p, O_WRONLY); if(fd<0) return false; bool ok=sysSync(fd); sysClose(fd); return ok; }
+static fs::path tmpPath(const fs::path& p){ fs::path t=p; t+=".tmp"; return t; }
+// Temp file + rename: readers and crashes see the old or the new content, never a torn
+// file. With sync the data is on disk before the rename and the rename before returning.
+static bool replaceFile(const fs::path& p,const string& data,bool sync){
+    fs::path tmp=tmpPath(p);
+    if(!writeFileSynced(tmp,data,sync)) return false;
+    std::error_code ec; fs::rename(tmp,p,ec);
+    if(ec){ fs::remove(tmp,ec); return false; }
+    if(sync) syncDir(p.parent_path());
+    return true;
+}
+
+// When a write counts as durable: never fsync, fsync once per batch of writes (group
+// commit, at most groupMs or groupWrites apart), or fsync every write.
+// VAULT7_DURABILITY=none | always | group[:<ms>[:<writes>]]   (default group:50:64)
+struct Durability {
+    enum Mode : uint8_t { NONE, GROUP, ALWAYS } mode=GROUP;
+    int groupMs=50, groupWrites=64;
+    const char* name() const { return mode==NONE? "none" : mode==ALWAYS? "always" : "group"; }
+    static Durability parse(const string& s){
+        Durability d;
+        if(s=="none") d.mode=NONE; else if(s=="always") d.mode=ALWAYS;
+        else if(s.rfind("group",0)==0){
+            int ms=0, w=0; int n=sscanf(s.c_str(),"group:%d:%d",&ms,&w);
+            if(n>=1 && ms>0) d.groupMs=ms;
+            if(n>=2 && w>0) d.groupWrites=w;
+        }
+        return d;
+    }
+    static Durability fromEnv(){ const char* e=getenv("VAULT7_DURABILITY"); return e? parse(e) : Durability{}; }
+};
+
+// ---------- VAULT IMAGE ----------
+// Read-only view of a file through the OS page cache (mmap / MapViewOfFile).
+class MappedFile {
+    const char* ptr=nullptr; size_t len=0;
+#ifdef _WIN32
+    HANDLE file=INVALID_HANDLE_VALUE, mapping=nullptr;
+#endif
+public:
+    MappedFile()=default;
+    MappedFile(const MappedFile&)=delete; MappedFile& operator=(const MappedFile&)=delete;
+    ~MappedFile(){ close(); }
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool open(const fs::path& p){
+        close();
+        std::error_code ec; size_t n=(size_t)fs::file_size(p,ec); if(ec || n==0) return false;
+#ifdef _WIN32
+        file=CreateFileW(p.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file==INVALID_HANDLE_VALUE) return false;
+        mapping=CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(!mapping){ close(); return false; }
+        ptr=(const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(!ptr){ close(); return false; }
+#else
+        int fd=::open(p.c_str(), O_RDONLY); if(fd<0) return false;
+        void* m=mmap(nullptr, n, PROT_READ, MAP_PRIVATE, fd, 0); ::close(fd);
+        if(m==MAP_FAILED) return false;
+        ptr=(const char*)m;
+#endif
+        len=n; return true;
+    }
+    void close(){
+#ifdef _WIN32
+        if(ptr) UnmapViewOfFile(ptr);
+        if(mapping) CloseHandle(mapping);
+        if(file!=INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping=nullptr; file=INVALID_HANDLE_VALUE;
+#else
+        if(ptr) munmap((void*)ptr, len);
+#endif
+        ptr=nullptr; len=0;
+    }
+};
+
+static void putU16(string& o,uint16_t v){ o.push_back(char(v&0xFF)); o.push_back(char(v>>8)); }
+constexpr size_t MAX_ID_LEN=0xFFFF;   // log and image records keep an id's length in a u16
+static uint16_t getU16(const char* p){ return uint16_t((unsigned char)p[0] | ((unsigned char)p[1]<<8)); }
+static void putU64(string& o,uint64_t v){ putU32(o,uint32_t(v)); putU32(o,uint32_t(v>>32)); }
+static uint64_t getU64(const char* p){ return getU32(p) | (uint64_t(getU32(p+4))<<32); }
+
+// Compact snapshot of the whole vault, mapped at open so nothing is parsed up front.
+//   header = "V7IMG001" | u32 count | u32 maxNumberedId | u64 indexOff | u64 fileSize
+//   index  = count x u64 record offset, sorted by (type, id)
+//   record = u8 type | u8 0 | u16 idLen | u32 bodyLen | id | body
+// Records are laid out oldest write first, so an offset also tells how recent an entry is.
+class VaultImage {
+    static constexpr const char* MAGIC = "V7IMG001";
+    static constexpr size_t HEADER = 32;
+    MappedFile map; uint32_t n=0;
+    const char* rec(size_t i) const { return map.data()+getU64(map.data()+getU64(map.data()+16)+8*i); }
+public:
+    using Entries = std::map<pair<char,string>,pair<uint64_t,string>>; // (type, id) -> (write order, body), in index order
+    struct Entry { char type; string_view id, body; uint64_t offset; };
+
+    bool open(const fs::path& p){
+        n=0;
+        if(!map.open(p)) return false;
+        const char* d=map.data(); size_t len=map.size();
+        if(len<HEADER || memcmp(d,MAGIC,8)!=0 || getU64(d+24)!=len){ map.close(); return false; }
+        uint32_t cnt=getU32(d+8); uint64_t idx=getU64(d+16);
+        if(idx<HEADER || idx+8ull*cnt>len){ map.close(); return false; }
+        n=cnt; return true;
+    }
+    void close(){ map.close(); n=0; }
+    bool isOpen() const { return map.data()!=nullptr; }
+    size_t size() const { return n; }
+    // Index positions [first, last) of one type's records.
+    pair<size_t,size_t> range(char type) const {
+        auto bound=[&](char t){ size_t lo=0, hi=n; while(lo<hi){ size_t mid=(lo+hi)/2; if(at(mid).type<t) lo=mid+1; else hi=mid; } return lo; };
+        return {bound(type), bound(char(type+1))};
+    }
+    // Highest id of an entry of a numbered type (notes), 0 without one.
+    size_t bytes() const { return map.size(); }
+    int maxNumberedId() const { return isOpen()? (int)getU32(map.data()+12) : 0; }
+    Entry at(size_t i) const {
+        const char* r=rec(i); uint16_t idLen=getU16(r+2); uint32_t bodyLen=getU32(r+4);
+        return { r[0], string_view(r+8,idLen), string_view(r+8+idLen,bodyLen), uint64_t(r-map.data()) };
+    }
+    bool contains(char type,string_view id) const {
+        size_t lo=0, hi=n;
+        while(lo<hi){
+            size_t mid=(lo+hi)/2; Entry e=at(mid);
+            int c = e.type!=type? (e.type<type? -1 : 1) : e.id.compare(id);
+            if(c==0) return true;
+            if(c<0) lo=mid+1; else hi=mid;
+        }
+        return false;
+    }
+    static bool write(const fs::path& p,const Entries& entries){
+        bool numbered[256]={};
+        for(auto& s: schemas) numbered[(unsigned char)typeLetter(s.type)]=s.numbered;
+        uint32_t maxNumbered=0;
+        vector<const Entries::value_type*> byKey; byKey.reserve(entries.size());
+        for(auto& e: entries) byKey.push_back(&e);
+        vector<size_t> byAge(byKey.size()); iota(byAge.begin(),byAge.end(),0);
+        stable_sort(byAge.begin(),byAge.end(),[&](size_t a,size_t b){ return byKey[a]->second.first<byKey[b]->second.first; });
+        vector<uint64_t> offset(byKey.size());
+        string data, index;
+        for(size_t i: byAge){
+            auto& [k,v]=*byKey[i]; const string& body=v.second;
+            offset[i]=HEADER+data.size();
+            data.push_back(k.first); data.push_back(0); putU16(data,(uint16_t)k.second.size()); putU32(data,(uint32_t)body.size());
+            data+=k.second; data+=body;
+            if(numbered[(unsigned char)k.first]) maxNumbered=max<uint32_t>(maxNumbered,(uint32_t)strtoul(k.second.c_str(),nullptr,10));
+        }
+        for(uint64_t o: offset) putU64(index,o);
+        string hdr=MAGIC; putU32(hdr,(uint32_t)entries.size()); putU32(hdr,maxNumbered);
+        putU64(hdr,HEADER+data.size()); putU64(hdr,HEADER+data.size()+index.size());
+        hdr.reserve(hdr.size()+data.size()+index.size()); hdr+=data; hdr+=index;
+        return writeFileSynced(p,hdr,true);
+    }
+};
+
+// ---------- VAULT LOG ----------
+// One append-only file instead of one .txt per entry: every add/edit/delete is a record,
+// so an edit costs one small append. The log only holds changes since the last image;
+// a background thread folds it into a fresh vault image once it grows past a fraction
+// of the image and starts the log over with whatever was appended meanwhile.
+//   file   = "V7LOG001" record*
+//   record = u32 len | u8 op | u8 type | u16 idLen | id | body | u32 fnv1a(op..body)
+// A torn record at the tail (crash mid-append) ends the replay and is cut off on open.
+class VaultLog {
+public:
+    enum Op : uint8_t { PUT=1, DEL=2 };
+    struct Record { uint8_t op; char type; string id, body; uint64_t seq=0; };   // seq: 1-based position in the log
+private:
+    static constexpr const char* MAGIC = "V7LOG001";
+    fs::path path, imgPath;
+    FILE* out=nullptr;
+    mutex mu;                              // guards out, total, imageCount
+    size_t total=0, imageCount=0;
+    thread compactor; atomic<bool> compacting{false};
+    bool verbose=true, held=false;
+
+    static string key(char type,const string& id){ return string(1,type)+'\x1f'+id; }
+    static string encode(const Record& r){
+        string rec; rec.push_back(char(r.op)); rec.push_back(r.type);
+        putU16(rec,(uint16_t)r.id.size()); rec+=r.id; rec+=r.body;
+        string o; putU32(o,(uint32_t)rec.size()); o+=rec; putU32(o,fnv1a(rec.data(),rec.size()));
+        return o;
+    }
+    // Walks records in buf[from,to); returns the end of the last intact record.
+    template<class F> static size_t scan(const string& buf,size_t from,size_t to,F&& f){
+        size_t p=from;
+        while(p+8<=to){
+            uint32_t len=getU32(&buf[p]); if(len<4 || p+8+len>to) break;
+            const char* r=&buf[p+4];
+            if(getU32(r+len)!=fnv1a(r,len)) break;
+            size_t idLen=getU16(r+2); if(4+idLen>len) break;
+            f(Record{ (uint8_t)r[0], r[1], string(r+4,idLen), string(r+4+idLen, len-4-idLen) });
+            p+=8+len;
+        }
+        return p;
+    }
+    // Final op per key (with its seq), in first-seen order. Deletes stay as tombstones so
+    // they can hide entries that only exist in the image underneath.
+    static vector<Record> replay(const string& buf,size_t from,size_t to,size_t* good=nullptr,size_t* count=nullptr){
+        vector<Record> slots; unordered_map<string,size_t> at; size_t n=0;
+        size_t end=scan(buf,from,to,[&](Record&& r){
+            r.seq=++n; string k=key(r.type,r.id); auto it=at.find(k);
+            if(it!=at.end()) slots[it->second]=std::move(r);
+            else { at[k]=slots.size(); slots.push_back(std::move(r)); }
+        });
+        if(good) *good=end;
+        if(count) *count=n;
+        return slots;
+    }
+    void compactNow(size_t snapEnd){
+        string buf=readFile(path); snapEnd=min(snapEnd,buf.size());
+        VaultImage::Entries merged;
+        // write order: image records by offset, then log records after all of them
+        uint64_t base=0;
+        { VaultImage cur; if(cur.open(imgPath)){ base=cur.bytes(); for(size_t i=0;i<cur.size();++i){ auto e=cur.at(i); merged[{e.type,string(e.id)}]={e.offset,string(e.body)}; } } }
+        for(auto& r: replay(buf,8,snapEnd)){ if(r.op==DEL) merged.erase({r.type,r.id}); else merged[{r.type,r.id}]={base+r.seq,std::move(r.body)}; }
+        fs::path tmpImg=imgPath; tmpImg+=".tmp";
+        fs::path tmpLog=path; tmpLog+=".tmp";
+        if(!VaultImage::write(tmpImg,merged)){ compacting=false; return; }
+        {
+            lock_guard<mutex> g(mu);
+            if(out) fflush(out);
+            // Records appended while we were merging start the new log.
+            string cur=readFile(path), tail=MAGIC; size_t tailRecs=0;
+            if(cur.size()>snapEnd){ size_t good=scan(cur,snapEnd,cur.size(),[&](Record&&){ ++tailRecs; }); tail.append(cur,snapEnd,good-snapEnd); }
+            if(!writeFileSynced(tmpLog,tail,true)){ std::error_code ec; fs::remove(tmpImg,ec); compacting=false; return; }
+            if(out){ fclose(out); out=nullptr; }
+            // Image first: a crash between the renames replays the old log over the new
+            // image, which is harmless since every record is last-writer-wins per key.
+            std::error_code ec; fs::rename(tmpImg,imgPath,ec);
+            if(!ec) fs::rename(tmpLog,path,ec);
+            if(!ec) syncDir(path.parent_path());
+            out=fopen(path.string().c_str(),"ab");
+            if(!ec){ total=tailRecs; imageCount=merged.size(); if(verbose) cout<<"[Compacted LOG] "<<fs::absolute(imgPath).string()<<" ("<<merged.size()<<" entries)"<<endl; }
+            else { fs::remove(tmpImg,ec); fs::remove(tmpLog,ec); }
+        }
+        compacting=false;
+    }
+
+public:
+    VaultLog(fs::path p,fs::path img):path(std::move(p)),imgPath(std::move(img)){}
+    ~VaultLog(){ if(compactor.joinable()) compactor.join(); if(out) fclose(out); }
+    const fs::path& file() const { return path; }
+    void setVerbose(bool v){ verbose=v; }
+
+    vector<Record> open(size_t entriesInImage){
+        fs::create_directories(path.parent_path());
+        string buf=readFile(path);
+        if(buf.size()<8 || buf.compare(0,8,MAGIC)!=0){
+            ofstream f(path, ios::binary|ios::trunc); f<<MAGIC; buf=MAGIC;
+        }
+        size_t good=8, n=0;
+        auto ops=replay(buf,8,buf.size(),&good,&n);
+        if(good<buf.size()){ std::error_code ec; fs::resize_file(path,good,ec); if(verbose) cout<<"[Truncated LOG] torn tail at "<<good<<endl; }
+        lock_guard<mutex> g(mu);
+        total=n; imageCount=entriesInImage;
+        out=fopen(path.string().c_str(),"ab");
+        return ops;
+    }
+    bool append(uint8_t op,char type,const string& id,const string& body=""){
+        if(id.size()>MAX_ID_LEN) return false;   // SecureVault::add takes no such id
+        string rec=encode(Record{op,type,id,body});
+        {
+            lock_guard<mutex> g(mu);
+            if(!out) return false;
+            if(fwrite(rec.data(),1,rec.size(),out)!=rec.size()) return false;
+            fflush(out);
+            ++total;
+        }
+        if(needsCompaction()) compactAsync();
+        return true;
+    }
+    // Forces appended records to disk (the durability policy decides when).
+    void sync(){ lock_guard<mutex> g(mu); if(out){ fflush(out); sysSync(fileno(out)); } }
+    bool needsCompaction(){ lock_guard<mutex> g(mu); return !held && total>=256 && total*8>=imageCount; }
+    // Bulk writers hold compaction off so the image is rewritten once at the end, not
+    // every time the log outgrows an eighth of it.
+    void holdCompaction(bool h){ { lock_guard<mutex> g(mu); held=h; } if(!h && needsCompaction()) compactAsync(); }
+    void compactAsync(){
+        if(compacting.exchange(true)) return;
+        if(compactor.joinable()) compactor.join();
+        size_t snapEnd;
+        { lock_guard<mutex> g(mu); if(out) fflush(out); std::error_code ec; snapEnd=(size_t)fs::file_size(path,ec); }
+        compactor=thread([this,snapEnd]{ compactNow(snapEnd); });
+    }
+};
+
+// ---------- VAULT WATCHER ----------
+// Linux inotify on the category directories, polled without blocking from the UI loop.
+// Changed file paths are collected until the directories have been quiet for a moment,
+// so a burst (sync tool, bulk copy) is handed over as one batch. Other platforms: no-op.
+class VaultWatcher {
+#ifdef __linux__
+    int fd=-1; unordered_map<int,fs::path> dirs;
+#endif
+    set<fs::path> changed; bool overflow=false;
+    chrono::steady_clock::time_point last;
+public:
+    VaultWatcher()=default;
+    VaultWatcher(const VaultWatcher&)=delete; VaultWatcher& operator=(const VaultWatcher&)=delete;
+    ~VaultWatcher(){ stop(); }
+    bool active() const {
+#ifdef __linux__
+        return fd>=0;
+#else
+        return false;
+#endif
+    }
+    void watch(const fs::path& dir){
+#ifdef __linux__
+        if(fd<0) fd=inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+        if(fd<0) return;
+        int wd=inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE|IN_MOVED_TO|IN_MOVED_FROM|IN_DELETE|IN_CREATE);
+        if(wd>=0) dirs[wd]=dir;
+#else
+        (void)dir;
+#endif
+    }
+    void stop(){
+#ifdef __linux__
+        if(fd>=0) ::close(fd);
+        fd=-1; dirs.clear();
+#endif
+    }
+    // Drains pending events; true once a batch is ready (nothing new for quietMs).
+    // rescan is set when the kernel queue overflowed and events were lost.
+    bool settled(int quietMs,set<fs::path>& out,bool& rescan){
+#ifdef __linux__
+        if(fd<0) return false;
+        alignas(inotify_event) char buf[16384];
+        for(;;){
+            ssize_t n=::read(fd,buf,sizeof(buf));
+            if(n<=0) break;
+            for(char* p=buf; p<buf+n; ){
+                auto* e=(inotify_event*)p; p+=sizeof(inotify_event)+e->len;
+                last=chrono::steady_clock::now();
+                if(e->mask & IN_Q_OVERFLOW){ overflow=true; continue; }
+                auto d=dirs.find(e->wd); if(d==dirs.end() || !e->len) continue;
+                fs::path f=d->second/e->name;
+                if(e->mask & IN_ISDIR){
+                    // a new shard directory: watch it and pick up whatever already landed in it
+                    if(e->mask & (IN_CREATE|IN_MOVED_TO)){ watch(f); std::error_code ec; for(auto& x: fs::directory_iterator(f,ec)) if(x.path().extension()==".txt") changed.insert(x.path()); }
+                    continue;
+                }
+                if(f.extension()==".txt" && !(e->mask & IN_CREATE)) changed.insert(f);
+            }
+        }
+#endif
+        if((changed.empty() && !overflow) || chrono::steady_clock::now()-last < chrono::milliseconds(quietMs)) return false;
+        out=std::move(changed); changed.clear(); rescan=overflow; overflow=false;
+        return true;
+    }
+};
+
+// ---------- PERSISTENCE QUEUE ----------
+// Write-behind for entry saves/deletes: callers only enqueue, one background thread does
+// the file or log I/O. A pending job for the same target is replaced by the newer one, and
+// a write whose bytes match what is already stored is dropped. Entry files are replaced
+// via temp file + rename; the Durability policy decides when data is fsync'd. Under group
+// commit, file writes stay in their temp files until the batch is synced and renamed, and
+// file deletes wait for that commit too: a file moved elsewhere (shard migration) is only
+// deleted once its new copy is in place.
+class PersistQueue {
+public:
+    struct Job { enum Kind : uint8_t { WRITE, REMOVE } kind; char type; string id; fs::path file; string body; const char* tag; };
+    using Clock = chrono::steady_clock;
+private:
+    Durability policy;
+    VaultLog* log=nullptr;                 // set: log records; null: one file per entry
+    bool verbose=true;
+    mutex mu; condition_variable wake, idle, room;
+    unordered_map<string,Job> pending; deque<string> order;
+    size_t cap=0;                          // push blocks while this many jobs are queued (0: never)
+    unordered_set<string> unsettled;      // targets pushed but not yet final on disk
+    unordered_set<string> stale;          // changed by someone else: drop from written
+    vector<string> batch;                 // targets waiting for the next group commit
+    bool busy=false, quit=false, forceCommit=false;
+    bool dirty=false; int dirtyCount=0; Clock::time_point deadline;   // uncommitted group writes
+    // worker only
+    unordered_map<string,uint64_t> written;   // target -> hash of the last body stored
+    map<fs::path,fs::path> staged;            // file -> temp holding its next content, empty: delete it (group commit)
+    vector<pair<string,Job>> run;             // jobs taken off the queue in one go
+    thread worker;
+
+    static uint64_t hash64(const string& s){ uint64_t h=1469598103934665603ull; for(unsigned char c: s){ h^=c; h*=1099511628211ull; } return h; }
+    string target(const Job& j) const { return log? string(1,j.type)+'\x1f'+j.id : j.file.string(); }
+    void note(const char* what,const Job& j){
+        if(!verbose) return;
+        if(log) cout<<"["<<what<<" "<<j.tag<<"] "<<fs::absolute(log->file()).string()<<" ("<<j.id<<")"<<endl;
+        else cout<<"["<<what<<" "<<j.tag<<"] "<<fs::absolute(j.file).string()<<endl;
+    }
+    // Returns true when the job left work for the next group commit.
+    bool perform(const Job& j){
+        string t=target(j);
+        bool sync = policy.mode==Durability::ALWAYS, group = policy.mode==Durability::GROUP;
+        if(j.kind==Job::REMOVE){
+            written.erase(t);
+            if(log){ log->append(VaultLog::DEL,j.type,j.id); if(sync) log->sync(); note("Deleted",j); return group; }
+            std::error_code ec;
+            auto st=staged.find(j.file); if(st!=staged.end() && !st->second.empty()){ fs::remove(st->second,ec); staged.erase(st); }
+            if(group){ staged[j.file]=fs::path(); note("Deleted",j); return true; }
+            fs::remove(j.file, ec);
+            if(sync) syncDir(j.file.parent_path());
+            note("Deleted",j);
+            return false;
+        }
+        uint64_t h=hash64(j.body);
+        auto w=written.find(t);
+        auto st=staged.find(j.file); bool deleting= st!=staged.end() && st->second.empty();   // still on disk, not for long
+        if(w!=written.end()? w->second==h : (!log && !deleting && readFile(j.file)==j.body)){ written[t]=h; return false; }
+        if(log){
+            if(!log->append(VaultLog::PUT,j.type,j.id,j.body)) return false;
+            if(sync) log->sync();
+            written[t]=h; note("Saved",j);
+            return group;
+        }
+        std::error_code ec; fs::create_directories(j.file.parent_path(), ec);
+        if(group){
+            fs::path tmp=tmpPath(j.file);
+            if(!writeFileSynced(tmp,j.body,false)) return false;
+            staged[j.file]=tmp;
+        } else if(!replaceFile(j.file,j.body,sync)) return false;
+        written[t]=h; note("Saved",j);
+        return group;
+    }
+    void commit(){
+        if(log){ log->sync(); return; }
+        set<fs::path> dirs, gone;
+        for(auto& [file,tmp]: staged) if(!tmp.empty()) syncFile(tmp);
+        for(auto& [file,tmp]: staged){ std::error_code ec; if(!tmp.empty()){ fs::rename(tmp,file,ec); dirs.insert(file.parent_path()); } }
+        for(auto& d: dirs) syncDir(d);
+        // deletes last, once the writes of this batch are durable
+        for(auto& [file,tmp]: staged){ std::error_code ec; if(tmp.empty()){ fs::remove(file,ec); gone.insert(file.parent_path()); } }
+        for(auto& d: gone) syncDir(d);
+        staged.clear();
+    }
+    void loop(){
+        unique_lock<mutex> l(mu);
+        for(;;){
+            bool due = dirty && (forceCommit || quit || dirtyCount>=max(policy.groupWrites,(int)cap) || Clock::now()>=deadline);
+            if(order.empty() && !due){
+                forceCommit=false;
+                if(!dirty) idle.notify_all();
+                if(quit && !dirty) return;
+                if(dirty) wake.wait_until(l,deadline); else wake.wait(l);
+                continue;
+            }
+            busy=true;
+            if(due){
+                dirty=false; dirtyCount=0;
+                l.unlock(); commit(); l.lock();
+                for(auto& k: batch) if(!pending.count(k)) unsettled.erase(k);
+                batch.clear();
+            } else {
+                // Take a run of jobs per wakeup so a bulk producer and this thread don't
+                // trade the lock back and forth for every entry.
+                run.clear();
+                unordered_set<string> drop; drop.swap(stale);
+                while(!order.empty() && run.size()<256){
+                    string k=std::move(order.front()); order.pop_front();
+                    auto it=pending.find(k); run.push_back({std::move(k),std::move(it->second)}); pending.erase(it);
+                }
+                if(cap) room.notify_all();
+                l.unlock();
+                for(auto& k: drop) written.erase(k);
+                vector<char> more(run.size());
+                for(size_t i=0;i<run.size();++i) more[i]=perform(run[i].second);
+                l.lock();
+                for(size_t i=0;i<run.size();++i){
+                    string& k=run[i].first;
+                    if(more[i]){ if(!dirty) deadline=Clock::now()+chrono::milliseconds(policy.groupMs); dirty=true; ++dirtyCount; batch.push_back(k); }
+                    else if(!pending.count(k)) unsettled.erase(k);
+                }
+            }
+            busy=false;
+        }
+    }
+public:
+    explicit PersistQueue(Durability d=Durability::fromEnv()):policy(d),worker([this]{ loop(); }){}
+    ~PersistQueue(){ { lock_guard<mutex> l(mu); quit=true; } wake.notify_all(); worker.join(); }
+    void setLog(VaultLog* l){ flush(); lock_guard<mutex> g(mu); log=l; }
+    void setVerbose(bool v){ lock_guard<mutex> g(mu); verbose=v; }
+    // Bounds memory for bulk producers: push waits while n jobs are already queued. Group
+    // commits grow to the same size meanwhile, so a bulk load isn't one fsync per 64 rows.
+    void setBackpressure(size_t n){ { lock_guard<mutex> g(mu); cap=n; } room.notify_all(); }
+    const Durability& durability() const { return policy; }
+    void push(Job j){
+        {
+            unique_lock<mutex> l(mu);
+            if(cap) room.wait(l,[&]{ return order.size()<cap; });
+            string k=target(j);
+            unsettled.insert(k);
+            auto it=pending.find(k);
+            if(it!=pending.end()){ it->second=std::move(j); return; }
+            order.push_back(k); pending.emplace(std::move(k),std::move(j));
+            if(order.size()>1) return;        // the worker is already on its way
+        }
+        wake.notify_one();
+    }
+    // True while a write/delete of this entry file is queued or not yet committed, i.e.
+    // what is on disk there is about to be replaced by our own state.
+    bool settling(const fs::path& file){ lock_guard<mutex> l(mu); return !log && unsettled.count(file.string()); }
+    // The entry file was changed or deleted by someone else, so what this session last
+    // wrote there is no longer on disk: the next write goes through even if it matches.
+    void forget(const fs::path& file){ lock_guard<mutex> l(mu); if(!log) stale.insert(file.string()); }
+    // Blocks until every queued job is stored. commitNow forces the pending group commit;
+    // without it this waits for the policy's own timer, i.e. the latency of a lone edit.
+    void flush(bool commitNow=true){
+        unique_lock<mutex> l(mu);
+        if(commitNow){ forceCommit=true; wake.notify_one(); }
+        idle.wait(l,[&]{ return order.empty() && !busy && !dirty; });
+    }
+};
+
+// ---------- WORKER POOL ----------
+// Fixed set of threads for data-parallel loops; the calling thread joins in, so a pool of
+// size 1 just runs the loop inline. Size comes from VAULT7_THREADS or the core count.
+class WorkerPool {
+    vector<thread> threads;
+    mutex mu; condition_variable wake, done;
+    const function<void(size_t)>* job=nullptr; size_t jobN=0; atomic<size_t> next{0};
+    size_t finished=0; uint64_t gen=0; bool quit=false;
+
+    void drain(){ for(size_t i; (i=next.fetch_add(1))<jobN; ) (*job)(i); }
+    void loop(){
+        uint64_t seen=0;
+        for(;;){
+            { unique_lock<mutex> l(mu); wake.wait(l,[&]{ return quit || gen!=seen; }); if(quit) return; seen=gen; }
+            drain();
+            { lock_guard<mutex> l(mu); if(++finished==threads.size()) done.notify_all(); }
+        }
+    }
+public:
+    static unsigned defaultThreads(){
+        if(const char* env=getenv("VAULT7_THREADS")){ int n=atoi(env); if(n>0) return (unsigned)n; }
+        return max(1u, thread::hardware_concurrency());
+    }
+    explicit WorkerPool(unsigned n){ for(unsigned i=1;i<n;++i) threads.emplace_back([this]{ loop(); }); }
+    ~WorkerPool(){ { lock_guard<mutex> l(mu); quit=true; } wake.notify_all(); for(auto& t: threads) t.join(); }
+    unsigned size() const { return (unsigned)threads.size()+1; }
+    // Runs fn(0..n-1) across the pool and returns once every index is done.
+    void parallelFor(size_t n,const function<void(size_t)>& fn){
+        if(n==0) return;
+        if(threads.empty() || n==1){ for(size_t i=0;i<n;++i) fn(i); return; }
+        { lock_guard<mutex> l(mu); job=&fn; jobN=n; next=0; finished=0; ++gen; }
+        wake.notify_all();
+        drain();
+        unique_lock<mutex> l(mu); done.wait(l,[&]{ return finished==threads.size(); });
+    }
+};
+
+// ---------- VAULT HEADER ----------
+// vault_data/vault.hdr, KEY=VALUE lines written when the vault is created.
+// CIPHER is the suite new values are sealed with (VAULT7_CIPHER at creation, otherwise
+// whichever is faster on that machine); changing it later only affects new writes.
+// The data key entries are sealed with is stored sealed under Argon2id(master, KDF_SALT)
+// with the KDF_* cost parameters, so unlocking costs what they say and nothing less.
+struct VaultHeader {
+    int version=1;
+    FieldCipher::Suite cipher=FieldCipher::preferred();
+    VaultCrypto::Argon2id::Params kdf;   // KDF_MEMORY (KiB), KDF_PASSES, KDF_LANES
+    string salt;                         // KDF_SALT, raw bytes (base64 in the file)
+    string vaultKey;                     // VAULT_KEY: the data key, sealed under the Argon2id key
+    string keyCheck;                     // ENTRY_KEY_CHECK: base64 HMAC of the entry key under the data key
+    string retiredKey;                   // RETIRED_VAULT_KEY: the previous data key while a rotation is unfinished
+    // false if the file is missing or names something this build doesn't know
+    bool load(const fs::path& p){
+        string buf; if(!readInto(p,buf)) return false;
+        bool ok=true; string_view rest=buf;
+        while(!rest.empty()){
+            size_t nl=rest.find('\n'); string_view line=rest.substr(0,nl);
+            rest = nl==string_view::npos? string_view{} : rest.substr(nl+1);
+            if(!line.empty() && line.back()=='\r') line.remove_suffix(1);
+            size_t eq=line.find('='); if(eq==string_view::npos) continue;
+            string_view k=line.substr(0,eq), v=line.substr(eq+1);
+            auto num=[&]{ return (uint32_t)strtoul(string(v).c_str(),nullptr,10); };
+            if(k=="VERSION") version=atoi(string(v).c_str());
+            else if(k=="CIPHER") ok&=FieldCipher::parseSuite(v,cipher);
+            else if(k=="KDF") ok&= v=="argon2id";
+            else if(k=="KDF_MEMORY") kdf.memoryKiB=num();
+            else if(k=="KDF_PASSES") kdf.passes=num();
+            else if(k=="KDF_LANES") kdf.lanes=num();
+            else if(k=="KDF_SALT") ok&=unbase64(v,salt);
+            else if(k=="VAULT_KEY") vaultKey=string(v);
+            else if(k=="ENTRY_KEY_CHECK") keyCheck=string(v);
+            else if(k=="RETIRED_VAULT_KEY") retiredKey=string(v);
+        }
+        return ok;
+    }
+    string serialize() const {
+        string o="VERSION="+to_string(version)+"\nCIPHER="+FieldCipher::suiteName(cipher)+"\n";
+        if(!vaultKey.empty()){
+            o+="KDF=argon2id\nKDF_MEMORY="+to_string(kdf.memoryKiB)+"\nKDF_PASSES="+to_string(kdf.passes)+"\nKDF_LANES="+to_string(kdf.lanes)+"\n";
+            o+="KDF_SALT="+base64((const uint8_t*)salt.data(),salt.size())+"\nVAULT_KEY="+vaultKey+"\nENTRY_KEY_CHECK="+keyCheck+"\n";
+            if(!retiredKey.empty()) o+="RETIRED_VAULT_KEY="+retiredKey+"\n";
+        }
+        return o;
+    }
+};
+
+// ---------- VAULT ----------
+class SecureVault {
+public:
+    enum class Storage { Files, Log };  // one .txt per entry, or the single vault log
+private:
+    // What vaults from before key derivation were unlocked with, and the entry key their
+    // entries were sealed with. The former only ever proves who may set the first real one.
+    string legacyMaster="ilovetohatethat", key="turndownforwhat";
+    array<vector<unique_ptr<SensitiveData>>,ENTRY_TYPES> parts;   // entries, one container per EntryType
+    // Each entry's slot: its index in the part and its place in the list orderings, which
+    // point back at the slot (identifier keys and map nodes don't move).
+    struct Slot;
+    // Title order: numbered ids by value, others alphabetically ignoring ASCII case (ties
+    // by bytes). prefix orders like the first 8 bytes, so a sort can compare it first.
+    struct TitleLess {
+        bool numbered;
+        static unsigned char fold(char c){ return (unsigned char)(c>='A' && c<='Z'? c+32 : c); }
+        uint64_t prefix(const string& x) const {
+            uint64_t k = numbered? min<uint64_t>(x.size(),255) : 0; size_t n = numbered? 7 : 8;
+            for(size_t i=0;i<n;++i) k = k<<8 | (i<x.size()? (numbered? (unsigned char)x[i] : fold(x[i])) : 0);
+            return k;
+        }
+        bool operator()(const Slot* a,const Slot* b) const {
+            const string &x=*a->id, &y=*b->id;
+            if(numbered) return x.size()!=y.size()? x.size()<y.size() : x<y;
+            size_t n=min(x.size(),y.size());
+            for(size_t i=0;i<n;++i) if(fold(x[i])!=fold(y[i])) return fold(x[i])<fold(y[i]);
+            return x.size()!=y.size()? x.size()<y.size() : x<y;
+        }
+    };
+    struct Slot {
+        size_t at; const string* id;
+        int64_t stamp;                            // how recent storage says it is; INT64_MAX once modified here
+        set<Slot*,TitleLess>::iterator byTitle;
+        list<Slot*>::iterator modified, viewed;   // most recent first
+    };
+    // Where the last page of an order started, so the next one walks from there.
+    template<class It> struct Cursor { uint64_t gen=~0ull; size_t pos=0; It it; };
+    struct Orders {
+        set<Slot*,TitleLess> byTitle; list<Slot*> modified, viewed;
+        vector<Slot*> unsorted;   // added by a bulk load, not in byTitle yet
+        bool stamped=false;       // modified follows the stamps (files mode: once first shown)
+        uint64_t gen=0;           // bumped by every change to the orders; older cursors are stale
+        Cursor<set<Slot*,TitleLess>::iterator> titleAt; Cursor<list<Slot*>::iterator> modifiedAt, viewedAt;
+        explicit Orders(bool numbered): byTitle(TitleLess{numbered}) {}
+    };
+    // Position from of seq (from < size), walked from the nearest of the first node, the
+    // last node and the cursor: paging on from the last page costs the rows moved.
+    template<class Seq,class It> static It seek(Seq& seq,size_t from,Cursor<It>& c,uint64_t gen){
+        size_t n=seq.size(), at; It it;
+        if(c.gen==gen && (c.pos>from? c.pos-from : from-c.pos)<min(from,n-from)){ it=c.it; at=c.pos; }
+        else if(from<=n-from){ it=seq.begin(); at=0; }
+        else { it=seq.end(); at=n; }
+        for(; at<from; ++at) ++it;
+        for(; at>from; --at) --it;
+        c={gen,from,it};
+        return it;
+    }
+    array<unordered_map<string,Slot>,ENTRY_TYPES> ids;            // identifier -> slot
+    array<Orders,ENTRY_TYPES> orders=makeOrders(make_index_sequence<ENTRY_TYPES>{});
+    template<size_t... I> static array<Orders,ENTRY_TYPES> makeOrders(index_sequence<I...>){ return {Orders(schemas[I].numbered)...}; }
+    int noteCounter=1;
+    Storage storage=Storage::Files;
+    bool opened=false;                     // open() has set up storage (log, watcher, cipher)
+    unique_ptr<VaultLog> log;
+    unsigned threads=WorkerPool::defaultThreads();
+    unique_ptr<WorkerPool> workers;        // started on first parallel job
+    PersistQueue persist;                  // after log: drained before the log closes
+    VaultWatcher watcher;                  // Files mode: outside edits to vault_data
+    VaultImage image;                      // mapped at open, read by LazyEntry loaders
+    VaultHeader header;                    // read at auth or open, whichever comes first
+    bool headerRead=false;
+    string dek;                            // data key, set by a successful auth
+    string retired;                        // previous data key while a rotation is unfinished
+    vector<VaultLog::Record> pendingLog;   // log ops to lay over the image
+    int loaded=0;                          // Category bits whose entries are in parts
+    bool bulk=false;                       // loading: put leaves the title order to endBulk
+    bool verbose=true;                     // one line per loaded entry
+
+    vector<unique_ptr<SensitiveData>>& part(EntryType t){ return parts[size_t(t)]; }
+    vector<unique_ptr<SensitiveData>>& part(char type){ return part(*typeOfLetter(type)); }   // type: a schema's letter
+    // Every change to a part goes through these, which keep ids and orders in step: put
+    // adds e (last in the recency lists, as it was never touched here) or replaces the entry
+    // with its identifier in place and returns its index; erase moves the last entry into the
+    // hole. O(1), plus O(log n) for the title order. A log-mode load passes how recently
+    // storage last wrote each entry (larger is newer) as stamp.
+    size_t put(unique_ptr<SensitiveData> e,int64_t stamp=0){
+        size_t t=size_t(e->type()); Orders& o=orders[t];
+        auto [at,added]=ids[t].try_emplace(e->getIdentifier());
+        Slot& s=at->second;
+        if(!added){ parts[t][s.at]=std::move(e); return s.at; }
+        s.at=parts[t].size(); s.id=&at->first; s.stamp=stamp; ++o.gen;
+        if(bulk) o.unsorted.push_back(&s); else s.byTitle=o.byTitle.insert(&s).first;
+        s.modified=o.modified.insert(o.modified.end(),&s);
+        s.viewed=o.viewed.insert(o.viewed.end(),&s);
+        parts[t].push_back(std::move(e));
+        return s.at;
+    }
+    // A load puts entries in shard order, random by title: one sort on cached prefixes and
+    // a linear build of the set beat a tree walk per entry. In log mode the modified order
+    // starts from the stamps, so it survives a restart (files mode: stampFiles).
+    void endBulk(){
+        bulk=false;
+        for(auto& o: orders){
+            if(o.unsorted.empty()) continue;
+            ++o.gen;
+            if(log) restamp(o);
+            TitleLess less=o.byTitle.key_comp();
+            vector<pair<uint64_t,Slot*>> keyed; keyed.reserve(o.unsorted.size());
+            for(Slot* s: o.unsorted) keyed.push_back({less.prefix(*s->id),s});
+            sort(keyed.begin(),keyed.end(),[&](auto& a,auto& b){ return a.first!=b.first? a.first<b.first : less(a.second,b.second); });
+            for(auto& k: keyed) k.second->byTitle=o.byTitle.insert(o.byTitle.end(),k.second);
+            o.unsorted.clear(); o.unsorted.shrink_to_fit();
+        }
+    }
+    bool erase(EntryType type,const string& id){
+        size_t t=size_t(type); auto& items=parts[t]; Orders& o=orders[t];
+        auto f=ids[t].find(id);
+        if(f==ids[t].end()) return false;
+        Slot& s=f->second; size_t i=s.at;
+        o.byTitle.erase(s.byTitle); o.modified.erase(s.modified); o.viewed.erase(s.viewed); ++o.gen;
+        ids[t].erase(f);
+        if(i+1!=items.size()){ items[i]=std::move(items.back()); ids[t][items[i]->getIdentifier()].at=i; }
+        items.pop_back();
+        return true;
+    }
+    SensitiveData* lookup(EntryType type,const string& id){
+        size_t t=size_t(type); auto f=ids[t].find(id);
+        return f==ids[t].end()? nullptr : parts[t][f->second.at].get();
+    }
+    // Moves an entry to the front of a recency list; O(1).
+    void touch(EntryType type,const string& id,list<Slot*> Orders::*which,list<Slot*>::iterator Slot::*pos){
+        size_t t=size_t(type); auto f=ids[t].find(id);
+        if(f==ids[t].end()) return;
+        auto& l=orders[t].*which; l.splice(l.begin(),l,f->second.*pos); ++orders[t].gen;
+    }
+    void modified(EntryType type,const string& id){
+        touch(type,id,&Orders::modified,&Slot::modified);
+        auto f=ids[size_t(type)].find(id); if(f!=ids[size_t(type)].end()) f->second.stamp=INT64_MAX;
+    }
+    // Puts the modified order in stamp order, newest first; ties keep their order.
+    static void restamp(Orders& o){
+        vector<Slot*> recent(o.modified.begin(),o.modified.end());
+        stable_sort(recent.begin(),recent.end(),[](Slot* a,Slot* b){ return a->stamp>b->stamp; });
+        for(Slot* s: recent) o.modified.splice(o.modified.end(),o.modified,s->modified);
+        o.stamped=true; ++o.gen;
+    }
+    // Files mode: entry file times as stamps, read the first time the modified order is
+    // needed rather than on every load (a stat per file). Entries changed here stay on top.
+    void stampFiles(EntryType type){
+        Orders& o=orders[size_t(type)]; auto& items=part(type);
+        vector<Slot*> v(o.modified.begin(),o.modified.end());
+        pool().parallelFor(v.size(),[&](size_t i){
+            if(v[i]->stamp==INT64_MAX) return;
+            std::error_code ec; auto t=fs::last_write_time(entryPath(*items[v[i]->at]),ec);
+            v[i]->stamp = ec? INT64_MIN : (int64_t)t.time_since_epoch().count();
+        });
+        restamp(o);
+    }
+
+    // Entry files live in hash-prefixed shards: <dir>/<shardOf(id)>/<filePrefix><entryFileName(id)>.txt
+    static fs::path dirOf(EntryType t){ return fs::path("vault_data")/schemaOf(t).dir; }
+    static fs::path entryPath(EntryType t,const string& id){ return dirOf(t)/shardOf(id)/(schemaOf(t).filePrefix+entryFileName(id)+".txt"); }
+    static fs::path entryPath(const SensitiveData& it){ return entryPath(it.type(),it.getIdentifier()); }
+    // Identifier from an entry file's name; false for names entryPath would not give.
+    static bool idOfFile(EntryType t,const fs::path& p,string& id){
+        string name=p.stem().string(); string_view prefix=schemaOf(t).filePrefix;
+        return name.compare(0,prefix.size(),prefix)==0 && entryIdFromFileName(string_view(name).substr(prefix.size()),id);
+    }
+    char categoryOf(const fs::path& file) const {
+        fs::path d=file.parent_path(); if(isShardDir(d)) d=d.parent_path();
+        string n=d.filename().string();
+        for(auto& s: schemas) if(n==s.dir) return typeLetter(s.type);
+        return 0;
+    }
+
+    fs::path hdrPath() const { return fs::path("vault_data")/"vault.hdr"; }
+    fs::path ckptPath() const { return fs::path("vault_data")/"rotation.ckpt"; }
+    void readHeader(){
+        if(headerRead) return;
+        headerRead=true;
+        if(fs::exists(hdrPath())){ if(!header.load(hdrPath())) cout<<"[Vault] unreadable header, sealing with "<<FieldCipher::suiteName(header.cipher)<<endl; return; }
+        const char* env=getenv("VAULT7_CIPHER");
+        if(env && !FieldCipher::parseSuite(env,header.cipher)) cout<<"[Vault] unknown VAULT7_CIPHER '"<<env<<"', using "<<FieldCipher::suiteName(header.cipher)<<endl;
+    }
+    bool writeHeader(){
+        std::error_code ec; fs::create_directories("vault_data",ec);
+        if(replaceFile(hdrPath(),header.serialize(),true)) return true;
+        cout<<"[Error] could not write "<<fs::absolute(hdrPath()).string()<<endl;
+        return false;
+    }
+    bool hasEntries() const {
+        std::error_code ec;
+        if(fs::exists(logPath(),ec) || fs::exists(imgPath(),ec)) return true;
+        for(auto& s: schemas) for(auto& e: fs::recursive_directory_iterator(dirOf(s.type),ec)) if(e.path().extension()==".txt") return true;
+        return false;
+    }
+    // Argon2id key that seals the data key in the header.
+    // progress sees the fraction done and cancels the derivation by returning false.
+    static bool deriveKek(const string& password,const string& salt,const VaultCrypto::Argon2id::Params& prm,string& kek,const function<bool(double)>& progress=nullptr){
+        kek.assign(32,'\0');
+        return VaultCrypto::Argon2id::derive(password.data(),password.size(),salt.data(),salt.size(),prm,(uint8_t*)kek.data(),kek.size(),progress);
+    }
+    // Seals data key k (and the retired key, mid-rotation) under password with prm and a
+    // fresh salt, and saves the header. check replaces the entry key check; without it a
+    // new vault gets the built-in key's.
+    bool wrapKey(const string& password,const string& k,const VaultCrypto::Argon2id::Params& prm,const function<bool(double)>& progress=nullptr,const string* check=nullptr){
+        VaultHeader next=header;
+        next.version=2; next.kdf=prm; next.salt.assign(16,'\0');
+        string kek;
+        if(!sysRandom(next.salt.data(),next.salt.size()) || !deriveKek(password,next.salt,prm,kek,progress)) return false;
+        FieldCipher wrap(kek); wrap.use(next.cipher);
+        next.vaultKey=wrap.seal(k,"vault7 vault key");
+        next.retiredKey=retired.empty()? string() : wrap.seal(retired,"vault7 retired vault key");
+        if(check) next.keyCheck=*check;
+        else if(next.keyCheck.empty()) next.keyCheck=EntryKey::check(k,key);
+        VaultCrypto::wipe(kek.data(),kek.size());
+        swap(header,next);
+        if(writeHeader()) return true;
+        swap(header,next);
+        return false;
+    }
+    bool unwrapKey(const string& password,string& k,string& old,const function<bool(double)>& progress=nullptr) const {
+        string kek;
+        bool ok=deriveKek(password,header.salt,header.kdf,kek,progress);
+        if(ok){
+            FieldCipher wrap(kek);
+            ok=wrap.open(header.vaultKey,"vault7 vault key",k) && (header.retiredKey.empty() || wrap.open(header.retiredKey,"vault7 retired vault key",old));
+        }
+        VaultCrypto::wipe(kek.data(),kek.size());
+        return ok;
+    }
+    // Keys the entry cipher and the entry key check with data key k (and retired key old).
+    void install(string k,string old){
+        dek=std::move(k); retired=std::move(old);
+        entryCipher().rekey(dek);
+        if(retired.empty()) entryCipher().dropRetired(); else entryCipher().retire(retired);
+        entryKey().set(dek,header.keyCheck);
+    }
+    fs::path logPath() const { return fs::path("vault_data")/"vault.log"; }
+    fs::path imgPath() const { return fs::path("vault_data")/"vault.img"; }
+
+    // Entry bodies: the same KEY=VALUE text goes into a .txt file or a log record. A secret
+    // already sealed under the current key and suite is copied; others (new, retired key)
+    // are sealed again, and one that no longer opens at all is kept as it is.
+    static string plainOf(char type,const string& id,const SensitiveData::Field& f){
+        if(!f.label) return string();
+        if(!f.sealed) return string(f.value);
+        Secret p; openField(type,id,f.label,f.value,p);
+        return p.str();
+    }
+    static string sealedOf(char type,const string& id,const char* label,const SensitiveData::Field& f){
+        if(!f.label) return sealField(type,id,label,"");
+        if(!f.sealed) return sealField(type,id,label,f.value);
+        Secret p; bool current=false;
+        if(!entryCipher().open(f.value,fieldAad(type,id,label),p,&current)) return string(f.value);
+        return current? string(f.value) : sealField(type,id,label,p);
+    }
+    // One KEY=VALUE line per schema field, identifier first.
+    static string bodyOf(const SensitiveData& it){
+        const EntrySchema& s=schemaOf(it.type()); char type=typeLetter(it.type());
+        SensitiveData::Field f[MAX_VALUES]={}; it.storedFields(f); string id=it.getIdentifier();
+        string o=string(s.fields[0].key)+"="+id+"\n";
+        for(size_t i=1;i<s.n;++i){
+            const FieldSpec& d=s.fields[i];
+            o.append(d.key).append(1,'=').append(d.sealedOnDisk()? sealedOf(type,id,d.label,f[i-1]) : plainOf(type,id,f[i-1])).append(1,'\n');
+        }
+        return o;
+    }
+
+    // Serialized here on the caller's thread; the I/O happens on the persistence thread.
+    void writeEntry(char type,const string& id,const fs::path& file,const string& body,const char* tag){
+        persist.push({PersistQueue::Job::WRITE, type, id, file, body, tag});
+    }
+    void removeEntry(char type,const string& id,const fs::path& file,const char* tag){
+        persist.push({PersistQueue::Job::REMOVE, type, id, file, {}, tag});
+    }
+
+    void save(const SensitiveData& it){
+        string id=it.getIdentifier();
+        writeEntry(typeLetter(it.type()), id, entryPath(it.type(),id), bodyOf(it), schemaOf(it.type()).tag);
+    }
+
+    // Re-reads one entry file after an outside change and replaces, adds or drops the entry
+    // it maps to. Our own queued writes win; a file dropped in at a non-canonical place
+    // (old flat layout) is moved into its shard. Returns the Category bit if anything changed.
+    int reloadFile(const fs::path& p){
+        char type=categoryOf(p);
+        if(!type || persist.settling(p)) return 0;
+        persist.forget(p);
+        int bit=categoryBit(type);
+        if(!(loaded&bit)) return 0;          // read from disk when first shown anyway
+        EntryType et=*typeOfLetter(type);   // categoryOf only names known ones
+        string buf;
+        if(!readInto(p,buf)){
+            // the id comes from the file name; only a non-canonical one needs the scan
+            string id; SensitiveData* gone=nullptr;
+            if(idOfFile(et,p,id)) gone=lookup(et,id);
+            if(!gone || entryPath(*gone)!=p){
+                gone=nullptr;
+                for(auto& it: part(et)) if(entryPath(*it)==p){ gone=it.get(); break; }
+            }
+            if(!gone) return 0;
+            erase(et,gone->getIdentifier());
+            cout<<"[External delete] "<<fs::absolute(p).string()<<endl;
+            return bit;
+        }
+        int nid=0; auto fresh=makeParsed(type,buf,&nid);
+        if(!fresh) return 0;
+        string id=fresh->getIdentifier();
+        SensitiveData* cur=lookup(et,id);
+        bool numbered=schemaOf(et).numbered;
+        if(entryPath(*fresh)!=p){
+            size_t at=put(std::move(fresh)); modified(et,id);
+            if(numbered) noteCounter=max(noteCounter, nid+1);
+            save(*part(et)[at]);
+            removeEntry(type, id, p, schemaOf(et).tag);
+            return bit;
+        }
+        if(cur){
+            auto* lazy=dynamic_cast<LazyEntry*>(cur);
+            if(!lazy || lazy->loaded()){   // a body never read can't be stale, no need to load it to compare
+                if(bodyOf(*cur)==buf) return 0;
+            }
+        } else if(numbered) noteCounter=max(noteCounter, nid+1);
+        put(std::move(fresh)); modified(et,id);
+        cout<<"[External change] "<<fs::absolute(p).string()<<endl;
+        return bit;
+    }
+
+    // Builds one entry from an entry file or log record body; null if the type is unknown
+    // or the identifier is missing (or, for a numbered type, not a number). Touches no vault state, so loader
+    // threads can call it.
+    static unique_ptr<SensitiveData> makeParsed(char type, string_view body, int* noteId=nullptr){
+        auto known=typeOfLetter(type);
+        if(!known) return nullptr;
+        EntryType t=*known; const EntrySchema& s=schemaOf(t);
+        EntryFields f; f.parse(body,s);
+        if(f.v[0].empty()) return nullptr;
+        string serial;
+        if(s.numbered){
+            int nid=0; auto r=from_chars(f.v[0].data(), f.v[0].data()+f.v[0].size(), nid);
+            if(r.ec!=errc()) return nullptr;
+            if(noteId) *noteId=nid;
+            f.v[0]=serial=to_string(nid);
+        }
+        return entryBuilder[size_t(t)](f.v,true);
+    }
+    bool addParsed(char type, string_view body, int64_t stamp=0){
+        int nid=0; auto it=makeParsed(type,body,&nid);
+        if(!it) return false;
+        bool numbered=schemaOf(it->type()).numbered;
+        put(std::move(it),stamp);
+        if(numbered) noteCounter = max(noteCounter, nid+1);
+        return true;
+    }
+    WorkerPool& pool(){ if(!workers) workers=make_unique<WorkerPool>(threads); return *workers; }
+    // Lists the chosen category directories on the worker pool. A file at its canonical
+    // place (<shard>/<entryFileName(id)>.txt) becomes a LazyEntry straight from its name;
+    // only other files (old flat layout, truncated names) are read and parsed up front.
+    // Entries land in their part in file name order, whatever the timing.
+    void loadFiles(int want){
+        struct Cat { fs::path dir; char type; const char* tag; bool on; vector<fs::path> files; };
+        vector<Cat> cats;
+        for(auto& s: schemas) cats.push_back({dirOf(s.type),typeLetter(s.type),s.tag,bool(want&categoryBit(s.type)),{}});
+        auto isEntry=[](const fs::directory_entry& e,std::error_code& ec){ return e.is_regular_file(ec) && e.path().extension()==".txt"; };   // skips leftover .tmp
+        vector<pair<int,fs::path>> shards; mutex shardMu;
+        pool().parallelFor(cats.size(),[&](size_t c){
+            std::error_code ec; if(!cats[c].on || !fs::exists(cats[c].dir,ec)) return;
+            for(auto& e: fs::directory_iterator(cats[c].dir,ec)){
+                if(e.is_directory(ec) && isShardDir(e.path())){ lock_guard<mutex> g(shardMu); shards.push_back({(int)c,e.path()}); }
+                else if(isEntry(e,ec)) cats[c].files.push_back(e.path());   // flat layout, migrated below
+            }
+        });
+        vector<vector<fs::path>> shardFiles(shards.size());
+        pool().parallelFor(shards.size(),[&](size_t i){
+            std::error_code ec;
+            for(auto& e: fs::directory_iterator(shards[i].second,ec)) if(isEntry(e,ec)) shardFiles[i].push_back(e.path());
+        });
+        for(size_t i=0;i<shards.size();++i){ auto& f=cats[shards[i].first].files; f.insert(f.end(),shardFiles[i].begin(),shardFiles[i].end()); }
+        for(auto& cat: cats) sort(cat.files.begin(), cat.files.end());
+        vector<pair<int,const fs::path*>> tasks;
+        for(size_t c=0;c<cats.size();++c) for(auto& f: cats[c].files) tasks.push_back({(int)c,&f});
+        vector<unique_ptr<SensitiveData>> parsed(tasks.size()); vector<int> noteIds(tasks.size(),0); vector<char> canonical(tasks.size(),0);
+        pool().parallelFor(tasks.size(),[&](size_t i){
+            const fs::path& p=*tasks[i].second; char type=cats[tasks[i].first].type; EntryType et=*typeOfLetter(type);
+            string id;
+            if(idOfFile(et,p,id) && p.parent_path().filename()==shardOf(id)){
+                auto r=from_chars(id.data(), id.data()+id.size(), noteIds[i]);
+                if(!schemaOf(et).numbered || (r.ec==errc() && r.ptr==id.data()+id.size())){
+                    parsed[i]=make_unique<LazyEntry>(et, std::move(id), [p,type]()->unique_ptr<SensitiveData>{ string buf; return readInto(p,buf)? makeParsed(type,buf) : nullptr; });
+                    canonical[i]=1;
+                    return;
+                }
+            }
+            thread_local string buf;
+            if(readInto(p,buf)) parsed[i]=makeParsed(type,buf,&noteIds[i]);
+        });
+        // Flat-layout files (written before sharding) are moved into their shard in the
+        // background through the persistence queue; if the shard copy already exists
+        // (interrupted migration) the flat one is just dropped. Log mode only reads them.
+        unordered_set<string> sharded; vector<pair<size_t,size_t>> migrate;  // task, index in its part
+        for(size_t i=0;i<tasks.size();++i)
+            if(parsed[i] && canonical[i]) sharded.insert(string(1,cats[tasks[i].first].type)+parsed[i]->getIdentifier());
+        size_t lazy=0;
+        for(size_t i=0;i<tasks.size();++i){
+            if(!parsed[i]) continue;
+            const Cat& cat=cats[tasks[i].first];
+            bool move=false;
+            if(!log && !canonical[i]){
+                if(sharded.count(string(1,cat.type)+parsed[i]->getIdentifier())){ removeEntry(cat.type, parsed[i]->getIdentifier(), *tasks[i].second, cat.tag); continue; }
+                move = entryPath(*parsed[i])!=*tasks[i].second;
+            }
+            size_t at=put(std::move(parsed[i]));
+            if(move) migrate.push_back({i,at});
+            if(schemaOf(*typeOfLetter(cat.type)).numbered) noteCounter=max(noteCounter, noteIds[i]+1);
+            if(canonical[i]) ++lazy;
+            else if(verbose) cout<<"[Loaded "<<cat.tag<<"] "<<fs::absolute(*tasks[i].second).string()<<endl;
+        }
+        if(verbose && lazy) cout<<"[Indexed] "<<lazy<<" entries by file name (bodies read on first use)"<<endl;
+        if(!migrate.empty()) cout<<"[Migrating] "<<migrate.size()<<" flat entry files into hash shards"<<endl;
+        for(auto [t,idx]: migrate){
+            const Cat& cat=cats[tasks[t].first]; SensitiveData& it=*part(cat.type)[idx];
+            save(it);
+            removeEntry(cat.type, it.getIdentifier(), *tasks[t].second, cat.tag);
+        }
+    }
+    // Log mode open: map the image and replay the log tail. Nothing is parsed until a
+    // category is first needed, and then only the log records laid over the image.
+    void loadLog(){
+        log=make_unique<VaultLog>(logPath(), imgPath());
+        log->setVerbose(verbose);
+        bool fresh=!fs::exists(logPath()) && !fs::exists(imgPath());
+        image.open(imgPath());
+        auto ops=log->open(image.size());
+        persist.setLog(log.get());
+        if(fresh){
+            // First run in log mode: carry the per-entry files over once, left in place on disk,
+            // oldest first so the log keeps their modified order
+            bulk=true; loadFiles(CAT_ALL); endBulk(); loaded=CAT_ALL;
+            for(size_t t=0;t<ENTRY_TYPES;++t) stampFiles(EntryType(t));
+            for(size_t t=0;t<ENTRY_TYPES;++t) for(auto i=orders[t].modified.rbegin(); i!=orders[t].modified.rend(); ++i) save(*parts[t][(*i)->at]);
+            return;
+        }
+        noteCounter=max(noteCounter, image.maxNumberedId()+1);
+        size_t unknown=0;
+        for(auto& r: ops){
+            auto t=typeOfLetter(r.type);
+            if(!t){ ++unknown; continue; }
+            if(schemaOf(*t).numbered && r.op==VaultLog::PUT) noteCounter=max(noteCounter, atoi(r.id.c_str())+1);
+        }
+        if(unknown) cout<<"[Vault] "<<unknown<<" log records of an unknown entry type skipped (kept on disk)"<<endl;
+        pendingLog=std::move(ops);
+        cout<<"[Mapped IMG] "<<fs::absolute(imgPath()).string()<<" ("<<image.size()<<" entries, "<<pendingLog.size()<<" from log)"<<endl;
+    }
+    // Log mode: entries of one type as LazyEntry stubs over the mapped image, with the
+    // log records for that type applied on top. Image offsets, then log positions after
+    // them, are the stamps: both follow write order.
+    void materialize(char type){
+        auto [from,to]=image.range(type);
+        unordered_map<string,VaultLog::Record*> over;
+        for(auto& r: pendingLog) if(r.type==type) over[r.id]=&r;
+        const VaultImage* img=&image;
+        for(size_t i=from;i<to;++i){
+            auto e=image.at(i);
+            auto o=over.find(string(e.id));
+            if(o!=over.end()){ auto* r=o->second; r->type=0; if(r->op==VaultLog::PUT) addParsed(type,r->body,int64_t(image.bytes()+r->seq)); continue; }
+            put(make_unique<LazyEntry>(*typeOfLetter(type), string(e.id), [img,i,type]{ return makeParsed(type,img->at(i).body); }),int64_t(e.offset));
+        }
+        for(auto& r: pendingLog) if(r.type==type && r.op==VaultLog::PUT) addParsed(type,r.body,int64_t(image.bytes()+r.seq));
+    }
+    // Brings in the given categories the first time they are asked for.
+    void ensure(int cats){
+        int want=cats & ~loaded;
+        if(!want) return;
+        loaded|=want;
+        bulk=true;
+        if(!log) loadFiles(want);
+        else for(auto& s: schemas) if(want&categoryBit(s.type)) materialize(typeLetter(s.type));
+        endBulk();
+        if(log && loaded==CAT_ALL){ pendingLog.clear(); pendingLog.shrink_to_fit(); }
+    }
+    // 0 for a type letter or name no schema has
+    static int categoryBit(char type){ auto t=typeOfLetter(type); return t? categoryBit(*t) : 0; }
+    static int categoryBit(const string& typeName){ auto t=typeOf(typeName); return t? categoryBit(*t) : 0; }
+    static optional<EntryType> typeOf(const string& typeName){ for(auto& s: schemas) if(typeName==s.name) return s.type; return nullopt; }
+
+public:
+    // Unlocks the vault: Argon2id(p, salt) must open the data key in the header. A vault
+    // without one (new, or from before key derivation) has no master password yet and opens
+    // only through setMaster; the built-in one is never taken here. progress follows the
+    // key derivation and may cancel it; nothing changes then.
+    bool auth(const string& p,const function<bool(double)>& progress=nullptr){
+        readHeader();
+        string k, old;
+        if(header.vaultKey.empty() || p==legacyMaster || !unwrapKey(p,k,old,progress)) return false;
+        install(std::move(k),std::move(old));
+        return true;
+    }
+    bool hasMaster(){ readHeader(); return !header.vaultKey.empty(); }
+    bool unlocked() const { return !dek.empty(); }
+    bool isOpen() const { return opened; }
+    bool isNew(){ return !hasMaster() && !hasEntries(); }
+    // Sets the master password to next and unlocks the vault. current must unlock it first:
+    // the master password, or the built-in one for a vault keyed with it or from before key
+    // derivation; a new vault needs none. The data key is sealed again under next with the
+    // current cost parameters and a fresh salt; a new vault gets a random data key, an old
+    // one keeps the fixed key its entries were sealed with until it is rotated. progress
+    // follows both key derivations as one; on failure error says why and nothing changes.
+    bool setMaster(const string& current,const string& next,string& error,const function<bool(double)>& progress=nullptr){
+        if(next.empty()){ error="the new master password is empty"; return false; }
+        if(next==legacyMaster){ error="the new master password is the built-in one"; return false; }
+        readHeader();
+        auto half=[&](double from){ return [&progress,from](double f){ return !progress || progress(from+f/2); }; };
+        string k, old;
+        VaultCrypto::Argon2id::Params prm=header.kdf;
+        if(!header.vaultKey.empty()){
+            if(!unwrapKey(current,k,old,half(0)) || (!dek.empty() && k!=dek)){ error="wrong master password"; return false; }
+        } else {
+            if(!hasEntries()){ k.resize(32); if(!sysRandom(k.data(),k.size())){ error="no system randomness"; return false; } }
+            else if(current==legacyMaster) k=key;
+            else { error="wrong master password"; return false; }
+            prm=VaultCrypto::Argon2id::Params(); prm.lanes=min(4u,max(1u,thread::hardware_concurrency()));
+        }
+        swap(retired,old);   // wrapKey seals the retired key from the member
+        bool ok=wrapKey(next,k,prm,half(0.5));
+        swap(retired,old);
+        if(!ok){ VaultCrypto::wipe(&k[0],k.size()); VaultCrypto::wipe(&old[0],old.size()); error="could not write the header"; return false; }
+        install(std::move(k),std::move(old));
+        return true;
+    }
+    bool validKey(const string& k) const { return entryKey().valid(k); }
+    // Re-derives the key wrap with new cost parameters and a fresh salt (calibrate).
+    bool rewrap(const string& password,const VaultCrypto::Argon2id::Params& prm){ return !dek.empty() && wrapKey(password,dek,prm); }
+    const VaultCrypto::Argon2id::Params& kdfParams() const { return header.kdf; }
+
+    // True if an entry has a secret that opens only under the retired key, or can't be read
+    // to tell; secrets that open under neither key (tampered) don't need it.
+    static bool needsRetired(const SensitiveData& it){
+        SensitiveData::Field f[MAX_VALUES]={}; int n=it.storedFields(f);
+        if(!n) return true;
+        char type=typeLetter(it.type()); string id=it.getIdentifier(); Secret p;
+        for(int i=0;i<n;++i){
+            if(!f[i].sealed) continue;
+            string aad=fieldAad(type,id,f[i].label);
+            if(!entryCipher().opensWithoutRetired(f[i].value,aad) && entryCipher().open(f[i].value,aad,p)) return true;
+        }
+        return false;
+    }
+    // Key rotation: a fresh random data key and a new entry key. The header switches first
+    // (new key current, old one kept as RETIRED_VAULT_KEY so entries not yet moved still
+    // open); then entries, in (type, id) order, are sealed again on the worker pool a chunk
+    // at a time and streamed to storage through the persistence queue. After each stored
+    // chunk vault_data/rotation.ckpt records the last (type, id) in it, so an interrupted
+    // rotation picks up after it when run again with the same new key. The retired key goes
+    // once a final pass finds no entry that still opens only under it.
+    // progress gets (entries done, total, done in this run, seconds); on failure error says why.
+    bool rotate(const string& password,const string& oldKey,const string& newKey,const function<void(size_t,size_t,size_t,double)>& progress,string& error){
+        if(dek.empty()){ error="the vault is locked"; return false; }
+        if(newKey.empty()){ error="the new entry key is empty"; return false; }
+        string k, old;
+        bool master=unwrapKey(password,k,old) && k==dek;
+        VaultCrypto::wipe(&k[0],k.size()); VaultCrypto::wipe(&old[0],old.size());
+        if(!master){ error="wrong master password"; return false; }
+        if(retired.empty()){
+            if(!validKey(oldKey)){ error="wrong entry key"; return false; }
+            string next(32,'\0');
+            if(!sysRandom(&next[0],next.size())){ error="no system randomness"; return false; }
+            string check=EntryKey::check(next,newKey);
+            retired=dek; dek=next;
+            if(!wrapKey(password,dek,header.kdf,nullptr,&check)){ swap(dek,retired); VaultCrypto::wipe(&retired[0],retired.size()); retired.clear(); error="could not write the header"; return false; }
+            entryCipher().rekey(dek); entryCipher().retire(retired); entryKey().set(dek,check);
+            std::error_code ec; fs::remove(ckptPath(),ec);
+        } else if(!validKey(newKey)){ error="an unfinished rotation to another entry key must be completed first"; return false; }
+
+        ensure(CAT_ALL);
+        vector<unique_ptr<SensitiveData>*> slots;
+        for(auto& items: parts) for(auto& it: items) slots.push_back(&it);
+        vector<size_t> order(slots.size()); iota(order.begin(),order.end(),0);
+        vector<pair<string,string>> keys(slots.size());
+        for(size_t i=0;i<slots.size();++i) keys[i]={(*slots[i])->getType(),(*slots[i])->getIdentifier()};
+        sort(order.begin(),order.end(),[&](size_t a,size_t b){ return keys[a]<keys[b]; });
+        size_t start=0;
+        {   // resume after the last entry stored: deletes since don't shift it, and entries
+            // added or edited since were sealed under the new key anyway. A checkpoint from
+            // another rotation (other key check) counts for nothing.
+            string buf, id;
+            if(readInto(ckptPath(),buf) && buf.compare(0,10,"KEY_CHECK=")==0 && buf.compare(10,header.keyCheck.size(),header.keyCheck)==0){
+                size_t t=buf.find("\nDONE_TYPE="), d=buf.find("\nDONE_ID=");
+                if(t!=string::npos && d!=string::npos && unbase64(string_view(buf).substr(d+9,buf.find('\n',d+9)-d-9),id)){
+                    pair<string,string> last{buf.substr(t+11,buf.find('\n',t+11)-t-11),id};
+                    start=upper_bound(order.begin(),order.end(),last,[&](const pair<string,string>& k,size_t i){ return k<keys[i]; })-order.begin();
+                }
+            }
+        }
+        const size_t chunk=1024, part=64;
+        auto t0=chrono::steady_clock::now();
+        vector<string> bodies; vector<unique_ptr<SensitiveData>> fresh;
+        // Seals the entries seq[from..] again, a chunk at a time; with checkpoint, each stored
+        // chunk is recorded in rotation.ckpt by its last (type, id).
+        auto reseal=[&](const vector<size_t>& seq,size_t from,bool checkpoint){
+            for(size_t at=from; at<seq.size(); at+=chunk){
+                size_t m=min(chunk,seq.size()-at);
+                bodies.assign(m,string()); fresh.clear(); fresh.resize(m);
+                pool().parallelFor((m+part-1)/part,[&](size_t c){
+                    for(size_t j=c*part;j<min(m,(c+1)*part);++j){
+                        const SensitiveData& it=**slots[seq[at+j]];
+                        SensitiveData::Field f[MAX_VALUES];
+                        if(!it.storedFields(f)) continue;   // unreadable: left as it is on disk
+                        bodies[j]=bodyOf(it);
+                        fresh[j]=makeParsed(typeLetter(it.type()),bodies[j]);
+                    }
+                });
+                for(size_t j=0;j<m;++j){
+                    if(!fresh[j]) continue;
+                    auto& slot=*slots[seq[at+j]];
+                    writeEntry(typeLetter(slot->type()), slot->getIdentifier(), entryPath(*slot), bodies[j], schemaOf(slot->type()).tag);
+                    slot=std::move(fresh[j]);
+                    VaultCrypto::wipe(&bodies[j][0],bodies[j].size());
+                }
+                persist.flush();
+                if(checkpoint){
+                    auto& last=keys[seq[at+m-1]];
+                    string ckpt="KEY_CHECK="+header.keyCheck+"\nDONE_TYPE="+last.first+"\nDONE_ID="+base64((const uint8_t*)last.second.data(),last.second.size())+"\n";
+                    if(!replaceFile(ckptPath(),ckpt,true)){ error="could not write "+ckptPath().string(); return false; }
+                }
+                if(progress) progress(at+m,seq.size(),at+m-from,chrono::duration<double>(chrono::steady_clock::now()-t0).count());
+            }
+            return true;
+        };
+        if(!reseal(order,start,true)) return false;
+        // The old key goes only when a full pass finds no entry that still needs it. One that
+        // does (stored before a checkpoint it wasn't part of) is sealed again, once.
+        for(int pass=0;;++pass){
+            vector<char> old(slots.size());
+            pool().parallelFor((slots.size()+part-1)/part,[&](size_t c){
+                for(size_t i=c*part;i<min(slots.size(),(c+1)*part);++i) old[i]=needsRetired(**slots[i]);
+            });
+            vector<size_t> left; for(size_t i: order) if(old[i]) left.push_back(i);
+            if(left.empty()) break;
+            if(pass){ error=to_string(left.size())+" entries still need the old key (first: "+keys[left[0]].first+" '"+keys[left[0]].second+"'); run rotate again"; return false; }
+            cerr<<"[Rotate] "<<left.size()<<" entries were still under the old key; sealing them again"<<endl;
+            if(!reseal(left,0,false)) return false;
+        }
+        // every entry is sealed under the new key now
+        header.retiredKey.clear();
+        if(!writeHeader()){ error="could not write the header"; return false; }
+        entryCipher().dropRetired();
+        VaultCrypto::wipe(&retired[0],retired.size()); retired.clear();
+        std::error_code ec; fs::remove(ckptPath(),ec);
+        return true;
+    }
+    bool rotating() const { return !retired.empty(); }
+    // Entries of one category (loaded on first use), in their own container: scanning it
+    // needs no type test.
+    const vector<unique_ptr<SensitiveData>>& category(EntryType t){ ensure(categoryBit(t)); return part(t); }
+    size_t count(int cats){ ensure(cats); size_t n=0; for(size_t t=0;t<ENTRY_TYPES;++t) if(cats&(1<<t)) n+=parts[t].size(); return n; }
+
+    // Batch decryption for export, audit and search. Plaintexts of all chosen entries go
+    // into the caller's buf (secure arena), so a caller with a whole vault to go through
+    // (export) passes bounded slices. The stored fields are collected (loading bodies) and
+    // measured on the worker pool, buf is sized once, then chunks of entries open into it.
+    // out[i] views into buf until buf changes. A wrong key decrypts nothing (false); an
+    // entry that cannot be read or fails authentication comes back with ok=false.
+    // values: the fields after the identifier, in field order.
+    struct Plain {
+        const SensitiveData* entry; string_view values[MAX_VALUES]; int n; bool ok;
+        string_view secret() const { return n? values[n-1] : string_view(); }   // the last field
+        string_view user() const { return n>1? values[0] : string_view(); }     // the first, if there are two or more
+    };
+    bool decryptBatch(const vector<const SensitiveData*>& entries,const string& k,vector<Plain>& out,Secret& buf){
+        out.clear(); buf.clear();
+        if(!validKey(k)) return false;
+        openBatch(pool(),entries,out,buf);
+        return true;
+    }
+    bool decryptCategory(int cats,const string& k,vector<Plain>& out,Secret& buf){
+        ensure(cats);
+        vector<const SensitiveData*> sel;
+        for(size_t t=0;t<ENTRY_TYPES;++t) if(cats&(1<<t)) for(auto& it: parts[t]) sel.push_back(it.get());
+        return decryptBatch(sel,k,out,buf);
+    }
+    // (type name, id) pairs; ids not in the vault are left out.
+    bool decryptIds(const vector<pair<string,string>>& ids,const string& k,vector<Plain>& out,Secret& buf){
+        unordered_set<string> want; int cats=0;
+        for(auto& [t,id]: ids){ want.insert(t+'\x1f'+id); cats|=categoryBit(t); }
+        ensure(cats);
+        vector<const SensitiveData*> sel;
+        for(size_t t=0;t<ENTRY_TYPES;++t) if(cats&(1<<t)) for(auto& it: parts[t]) if(want.count(it->getType()+'\x1f'+it->getIdentifier())) sel.push_back(it.get());
+        return decryptBatch(sel,k,out,buf);
+    }
+    // The batch itself, on any pool (the benchmark sweeps pool sizes). No key check.
+    static void openBatch(WorkerPool& pool,const vector<const SensitiveData*>& entries,vector<Plain>& out,Secret& buf){
+        const size_t n=entries.size(), chunk=64, chunks=(n+chunk-1)/chunk;
+        struct Slot { SensitiveData::Field f[MAX_VALUES]; int nf=0; size_t off=0; };
+        vector<Slot> slots(n);
+        auto len=[](const SensitiveData::Field& f){ return f.sealed? FieldCipher::openedSize(f.value) : f.value.size(); };
+        pool.parallelFor(chunks,[&](size_t c){ for(size_t i=c*chunk;i<min(n,(c+1)*chunk);++i) slots[i].nf=entries[i]->storedFields(slots[i].f); });
+        size_t total=0;
+        for(auto& sl: slots){ sl.off=total; for(int j=0;j<sl.nf;++j) total+=len(sl.f[j]); }
+        char* base=buf.reset(total); out.resize(n);
+        pool.parallelFor(chunks,[&](size_t c){
+            thread_local string aad;
+            for(size_t i=c*chunk;i<min(n,(c+1)*chunk);++i){
+                const Slot& sl=slots[i]; Plain& p=out[i];
+                p={entries[i],{},0,sl.nf>0};
+                if(!p.ok) continue;
+                char type=typeLetter(entries[i]->type()); string id=entries[i]->getIdentifier();
+                char* dst=base+sl.off;
+                for(int j=0;j<sl.nf;++j){
+                    size_t m=len(sl.f[j]);
+                    if(!sl.f[j].sealed) memcpy(dst,sl.f[j].value.data(),m);
+                    else { fieldAad(aad,type,id,sl.f[j].label); if(!entryCipher().open(sl.f[j].value,aad,dst)) p.ok=false; }
+                    p.values[j]=string_view(dst,m); dst+=m;
+                }
+                if(!p.ok){ VaultCrypto::wipe(base+sl.off,size_t(dst-base-sl.off)); p.n=0; continue; }
+                p.n=sl.nf;
+            }
+        });
+    }
+
+    void setThreads(unsigned n){ threads=max(1u,n); workers.reset(); }
+    void setVerbose(bool v){ verbose=v; persist.setVerbose(v); if(log) log->setVerbose(v); }
+    void flush(){ persist.flush(); }
+
+    // Bulk import: add() between these inserts or replaces entries by (type, id) through
+    // the index. Every entry stays in memory (sealed) like any other, so memory grows with
+    // the vault and the import; what is bounded is the persistence queue, so writes pending
+    // on disk don't pile up on top. endImport waits until it is stored.
+    void beginImport(){
+        ensure(CAT_ALL);
+        persist.setBackpressure(4096);
+        if(log) log->holdCompaction(true);
+    }
+    void endImport(){
+        persist.setBackpressure(0); persist.flush();
+        if(log) log->holdCompaction(false);
+    }
+
+    enum Category { CAT_PW=1, CAT_BC=2, CAT_NT=4, CAT_TOTP=8, CAT_SSH=16, CAT_CARD=32, CAT_ALL=(1<<ENTRY_TYPES)-1 };
+    static int categoryBit(EntryType t){ return 1<<int(t); }
+    // O(1) through the (type, id) index.
+    SensitiveData* find(EntryType type,const string& id){ ensure(categoryBit(type)); return lookup(type,id); }
+    // Applies entry files created/changed/deleted by someone else since the last batch;
+    // returns the Category bits that changed (0 most frames). Call once per frame.
+    int syncExternal(){
+        set<fs::path> paths; bool rescan=false;
+        if(!watcher.settled(150,paths,rescan)) return 0;
+        if(rescan){
+            for(auto& sc: schemas){ std::error_code ec; for(auto& e: fs::recursive_directory_iterator(dirOf(sc.type),ec)) if(e.path().extension()==".txt") paths.insert(e.path()); }
+            for(auto& items: parts) for(auto& it: items) paths.insert(entryPath(*it));
+        }
+        int mask=0;
+        for(auto& p: paths) mask|=reloadFile(p);
+        return mask;
+    }
+
+    // Storage: Files unless vault_data/vault.log exists or VAULT7_STORAGE=log
+    static Storage defaultStorage(){
+        const char* env=getenv("VAULT7_STORAGE");
+        if(env) return string(env)=="log"? Storage::Log : Storage::Files;
+        return fs::exists(fs::path("vault_data")/"vault.log")? Storage::Log : Storage::Files;
+    }
+    // Files mode reads nothing here: each category is listed when first asked for.
+    bool open(Storage s){
+        storage=s;
+        if(!openHeader()) return false;
+        opened=true;
+        if(s==Storage::Log){ loadLog(); return true; }
+        std::error_code ec;
+        for(auto& sc: schemas){
+            fs::path d=dirOf(sc.type);
+            fs::create_directories(d,ec); watcher.watch(d);
+            for(auto& e: fs::directory_iterator(d,ec)) if(e.is_directory(ec) && isShardDir(e.path())) watcher.watch(e.path());
+        }
+        return true;
+    }
+
+    // Seals with the header's cipher; false until auth or setMaster has unlocked the vault
+    // (nothing could be opened or sealed).
+    bool openHeader(){
+        readHeader();
+        if(dek.empty()){ cout<<"[Vault] locked: unlock with the master password first"<<endl; return false; }
+        entryCipher().use(header.cipher);
+        if(verbose) cout<<"[Vault] cipher "<<FieldCipher::suiteName(header.cipher)<<" ("<<entryCipher().aead(header.cipher).kernel()<<")"<<endl;
+        return true;
+    }
+
+    // Add + persist (an existing identifier is replaced, as its file would be). values are
+    // plaintext, one per field after the identifier; a numbered type takes its id as a
+    // number or "" for the next one. False if something doesn't fit its field.
+    bool add(EntryType t,string id,vector<string_view> values){
+        const EntrySchema& s=schemaOf(t);
+        if(values.size()!=s.n-1) return false;
+        for(size_t i=1;i<s.n;++i) if(!s.fields[i].accepts(values[i-1])) return false;
+        ensure(categoryBit(t));   // a numbered type's next id is known once its entries are
+        if(s.numbered){
+            int nid=noteCounter;
+            if(!id.empty()){ auto r=from_chars(id.data(), id.data()+id.size(), nid); if(r.ec!=errc() || r.ptr!=id.data()+id.size() || nid<0) return false; }
+            noteCounter=max(noteCounter, nid+1);
+            id=to_string(nid);
+        } else if(id.empty() || id.size()>MAX_ID_LEN || !s.fields[0].accepts(id)) return false;
+        values.insert(values.begin(),id);
+        save(*part(t)[put(entryBuilder[size_t(t)](values.data(),false))]);
+        modified(t,id);
+        return true;
+    }
+    // Edit + persist: values for the secret fields, in field order.
+    bool update(EntryType t,const string& id,const string& k,const vector<string_view>& values){
+        SensitiveData* it=find(t,id);
+        if(!it || !validKey(k)) return false;
+        const EntrySchema& s=schemaOf(t); size_t j=0;
+        for(size_t i=1;i<s.n;++i) if(s.fields[i].secret && j<values.size() && !s.fields[i].accepts(values[j++])) return false;
+        it->edit(k,values);
+        save(*it); modified(t,id);
+        return true;
+    }
+    // Delete from memory + storage; the last entry of the category takes the freed slot
+    bool remove(EntryType t,const string& id){
+        ensure(categoryBit(t));
+        if(!erase(t,id)) return false;
+        removeEntry(typeLetter(t), id, entryPath(t,id), schemaOf(t).tag);
+        return true;
+    }
+
+    // List orders, kept up to date on every add/edit/delete/view. Modified starts from what
+    // storage says (file times, or write order in the log and image); viewed covers this
+    // session, with entries not viewed yet following in load order.
+    enum class Order { Title, Modified, Viewed };
+    // Marks an entry as just viewed (its detail view opened); O(1).
+    void viewed(EntryType t,const string& id){ touch(t,id,&Orders::viewed,&Slot::viewed); }
+    // Up to n entries of a category from position from in order o. Walks n nodes from the
+    // previous page's start (or an end, if nearer), so switching the order or scrolling
+    // costs the rows shown and moved, not a sort or the offset.
+    vector<const SensitiveData*> page(EntryType t,Order o,size_t from,size_t n){
+        ensure(categoryBit(t));
+        vector<const SensitiveData*> out; auto& items=part(t); Orders& ord=orders[size_t(t)];
+        if(o==Order::Modified && !ord.stamped) stampFiles(t);
+        auto walk=[&](auto& seq,auto& cursor){
+            if(from>=seq.size()) return;
+            for(auto i=seek(seq,from,cursor,ord.gen); i!=seq.end() && out.size()<n; ++i) out.push_back(items[(*i)->at].get());
+        };
+        if(o==Order::Title) walk(ord.byTitle,ord.titleAt);
+        else if(o==Order::Modified) walk(ord.modified,ord.modifiedAt);
+        else walk(ord.viewed,ord.viewedAt);
+        return out;
+    }
+};
+
+// ---------- UNLOCKED SESSION ----------
+// What detail views decrypt through. The entry key is checked once when it is entered, and
+// decrypted rows stay in a small LRU for ttl after their last view, so a view redrawn every
+// frame runs no crypto and allocates nothing after the first frame. The values live in
+// the secure arena and are wiped as they are dropped; lock() also wipes the key.
+class UnlockedSession {
+public:
+    using RowSet=SensitiveData::RowSet;
+    explicit UnlockedSession(size_t capacity=32,chrono::seconds ttl=chrono::seconds(120)):capacity(max<size_t>(1,capacity)),ttl(ttl){}
+    ~UnlockedSession(){ lock(); }
+    UnlockedSession(const UnlockedSession&)=delete; UnlockedSession& operator=(const UnlockedSession&)=delete;
+
+    bool unlock(const SecureVault& vault,const string& k){
+        if(unlocked() && k==key) return true;
+        lock();
+        if(!vault.validKey(k)) return false;
+        key=k; return true;
+    }
+    bool unlocked() const { return !key.empty(); }
+    const string& enteredKey() const { return key; }
+    void lock(){ wipe(key); forgetAll(); }
+    // Drops cached plaintext: one entry after it is edited or deleted, all of them when the
+    // vault changes on disk. The key stays.
+    void forget(EntryType type,const string& id){
+        auto& ix=index[size_t(type)]; auto f=ix.find(id);
+        if(f!=ix.end()) drop(f->second);
+    }
+    void forgetAll(){ lru.clear(); for(auto& ix: index) ix.clear(); }
+    // Evicts what has not been viewed for ttl; called once per frame.
+    void expire(){ auto now=Clock::now(); while(!lru.empty() && now-lru.back().used>ttl) drop(prev(lru.end())); }
+
+    // Decrypted rows of it, whose identifier is id (the caller has it, so a cached view
+    // builds no string). Valid until the next call; failed opens are not cached.
+    const RowSet& rows(const SensitiveData& it,const string& id){
+        static const RowSet locked=SensitiveData::errorRows("Invalid decryption key.");
+        if(!unlocked()) return locked;
+        auto& ix=index[size_t(it.type())];
+        auto f=ix.find(id);
+        if(f!=ix.end()){
+            f->second->used=Clock::now();
+            lru.splice(lru.begin(),lru,f->second);
+            return lru.front().rows;
+        }
+        ++misses;
+        Secret buf; RowSet r=it.decryptedRows(key,buf);
+        if(!r.ok){ failed=r; return failed; }
+        if(lru.size()>=capacity) drop(prev(lru.end()));
+        lru.push_front({it.type(),id,std::move(buf),r,Clock::now()});   // r views into buf's block, which moves along
+        ix.emplace(id,lru.begin());
+        return lru.front().rows;
+    }
+    size_t cached() const { return lru.size(); }
+    size_t decrypts() const { return misses; }
+
+private:
+    using Clock=chrono::steady_clock;
+    struct Entry { EntryType type; string id; Secret buf; RowSet rows; Clock::time_point used; };
+    size_t capacity; chrono::seconds ttl;
+    string key;
+    list<Entry> lru;                                   // most recently viewed first
+    array<unordered_map<string,list<Entry>::iterator>,ENTRY_TYPES> index;
+    RowSet failed;                                     // an uncached error result
+    size_t misses=0;
+    static void wipe(string& s){ VaultCrypto::wipe(&s[0],s.size()); s.clear(); }
+    void drop(list<Entry>::iterator e){ index[size_t(e->type)].erase(e->id); lru.erase(e); }
+};
@@ -0,0 +1,745 @@
+// Vault_7 crypto primitives: SHA-256/HMAC, AES-256-GCM and ChaCha20-Poly1305.
+// Header-only; x86 kernels are compiled with per-function target attributes and picked
+// at runtime from CPUID, so the binary still runs on CPUs without them.
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define V7_X86 1
+#include <immintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define V7_TARGET(x)
+#else
+#include <cpuid.h>
+#define V7_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace VaultCrypto {
+
+// Zeroes key material in a way the optimizer can't drop.
+inline void wipe(void* p,size_t n){ volatile uint8_t* v=(volatile uint8_t*)p; while(n--) *v++=0; }
+
+// Constant-time equality for tags and MACs.
+inline bool equal(const uint8_t* a,const uint8_t* b,size_t n){ uint8_t d=0; for(size_t i=0;i<n;++i) d|=a[i]^b[i]; return d==0; }
+
+inline uint32_t load32be(const uint8_t* p){ return (uint32_t)p[0]<<24 | (uint32_t)p[1]<<16 | (uint32_t)p[2]<<8 | p[3]; }
+inline void store32be(uint8_t* p,uint32_t v){ p[0]=uint8_t(v>>24); p[1]=uint8_t(v>>16); p[2]=uint8_t(v>>8); p[3]=uint8_t(v); }
+inline uint32_t bswap32(uint32_t v){ return v>>24 | (v>>8&0xFF00) | (v<<8&0xFF0000) | v<<24; }
+inline uint64_t load64be(const uint8_t* p){ return (uint64_t)load32be(p)<<32 | load32be(p+4); }
+inline void store64be(uint8_t* p,uint64_t v){ store32be(p,uint32_t(v>>32)); store32be(p+4,uint32_t(v)); }
+
+// CPU features the x86 kernels need, probed once.
+struct Cpu {
+    bool sse2=false, aes=false, pclmul=false, ssse3=false, sse41=false, avx2=false;
+    static const Cpu& get(){ static const Cpu c=probe(); return c; }
+private:
+    static Cpu probe(){
+        Cpu c;
+#ifdef V7_X86
+        unsigned r1[4]={0}, r7[4]={0};   // eax, ebx, ecx, edx of leaves 1 and 7
+#ifdef _MSC_VER
+        int r[4]; __cpuid(r,0); int maxLeaf=r[0];
+        __cpuid(r,1); for(int i=0;i<4;++i) r1[i]=(unsigned)r[i];
+        if(maxLeaf>=7){ __cpuidex(r,7,0); for(int i=0;i<4;++i) r7[i]=(unsigned)r[i]; }
+        bool osAvx = (r1[2]>>27&1) && (_xgetbv(0)&6)==6;
+#else
+        if(!__get_cpuid(1,&r1[0],&r1[1],&r1[2],&r1[3])) return c;
+        if(__get_cpuid_max(0,nullptr)>=7) __cpuid_count(7,0,r7[0],r7[1],r7[2],r7[3]);
+        bool osAvx=false;
+        if(r1[2]>>27&1){ unsigned lo,hi; __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0)); osAvx=(lo&6)==6; }
+#endif
+        c.sse2=r1[3]>>26&1; c.pclmul=r1[2]>>1&1; c.ssse3=r1[2]>>9&1; c.sse41=r1[2]>>19&1; c.aes=r1[2]>>25&1;
+        c.avx2=osAvx && (r7[1]>>5&1);
+#endif
+        return c;
+    }
+};
+
+// ---------- SHA-256 ----------
+class Sha256 {
+    uint32_t h[8]; uint8_t buf[64]; uint64_t total=0; size_t used=0;
+    static uint32_t ror(uint32_t x,int n){ return x>>n | x<<(32-n); }
+    void block(const uint8_t* p){
+        static const uint32_t K[64]={
+            0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+            0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+            0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+            0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+            0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+            0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+            0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+            0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2 };
+        uint32_t w[64];
+        for(int i=0;i<16;++i) w[i]=load32be(p+4*i);
+        for(int i=16;i<64;++i){ uint32_t s0=ror(w[i-15],7)^ror(w[i-15],18)^(w[i-15]>>3), s1=ror(w[i-2],17)^ror(w[i-2],19)^(w[i-2]>>10); w[i]=w[i-16]+s0+w[i-7]+s1; }
+        uint32_t a=h[0],b=h[1],c=h[2],d=h[3],e=h[4],f=h[5],g=h[6],k=h[7];
+        for(int i=0;i<64;++i){
+            uint32_t t1=k+(ror(e,6)^ror(e,11)^ror(e,25))+((e&f)^(~e&g))+K[i]+w[i];
+            uint32_t t2=(ror(a,2)^ror(a,13)^ror(a,22))+((a&b)^(a&c)^(b&c));
+            k=g; g=f; f=e; e=d+t1; d=c; c=b; b=a; a=t1+t2;
+        }
+        h[0]+=a; h[1]+=b; h[2]+=c; h[3]+=d; h[4]+=e; h[5]+=f; h[6]+=g; h[7]+=k;
+    }
+public:
+    static constexpr size_t SIZE=32;
+    Sha256(){ static const uint32_t iv[8]={0x6a09e667,0xbb67ae85,0x3c6ef372,0xa54ff53a,0x510e527f,0x9b05688c,0x1f83d9ab,0x5be0cd19}; memcpy(h,iv,sizeof(h)); }
+    ~Sha256(){ wipe(h,sizeof(h)); wipe(buf,sizeof(buf)); }
+    Sha256& update(const void* data,size_t n){
+        const uint8_t* p=(const uint8_t*)data; total+=n;
+        if(used){ size_t k=std::min(n,64-used); memcpy(buf+used,p,k); used+=k; p+=k; n-=k; if(used==64){ block(buf); used=0; } }
+        for(; n>=64; p+=64, n-=64) block(p);
+        if(n){ memcpy(buf,p,n); used=n; }
+        return *this;
+    }
+    Sha256& update(const std::string& s){ return update(s.data(),s.size()); }
+    void final(uint8_t out[SIZE]){
+        uint64_t bits=total*8; uint8_t pad=0x80, z=0;
+        update(&pad,1); while(used!=56) update(&z,1);
+        uint8_t len[8]; store64be(len,bits); update(len,8);
+        for(int i=0;i<8;++i) store32be(out+4*i,h[i]);
+    }
+    static void hash(const void* data,size_t n,uint8_t out[SIZE]){ Sha256().update(data,n).final(out); }
+};
+
+// HMAC-SHA-256 (RFC 2104).
+class HmacSha256 {
+    Sha256 inner, outer;
+public:
+    HmacSha256(const void* key,size_t n){
+        uint8_t k[64]={0};
+        if(n>64) Sha256::hash(key,n,k); else memcpy(k,key,n);
+        uint8_t pad[64];
+        for(int i=0;i<64;++i) pad[i]=k[i]^0x36;
+        inner.update(pad,64);
+        for(int i=0;i<64;++i) pad[i]=k[i]^0x5c;
+        outer.update(pad,64);
+        wipe(k,sizeof(k)); wipe(pad,sizeof(pad));
+    }
+    HmacSha256& update(const void* data,size_t n){ inner.update(data,n); return *this; }
+    void final(uint8_t out[Sha256::SIZE]){ uint8_t ih[32]; inner.final(ih); outer.update(ih,32).final(out); wipe(ih,32); }
+};
+
+// ---------- AEAD ----------
+// What the vault seals entry fields through: 256-bit key, 96-bit nonce, 128-bit tag.
+class Aead {
+public:
+    static constexpr size_t KEY=32, NONCE=12, TAG=16;
+    virtual ~Aead(){}
+    virtual const char* name() const = 0;     // "aes-256-gcm", "chacha20-poly1305"
+    virtual const char* kernel() const = 0;   // implementation picked for this CPU
+    // out gets n bytes of ciphertext (may alias in), tag the 16-byte authenticator.
+    virtual void seal(const uint8_t nonce[NONCE],const uint8_t* aad,size_t aadLen,const uint8_t* in,size_t n,uint8_t* out,uint8_t tag[TAG]) const = 0;
+    // Verifies the tag before decrypting anything; false leaves out untouched.
+    virtual bool open(const uint8_t nonce[NONCE],const uint8_t* aad,size_t aadLen,const uint8_t* in,size_t n,const uint8_t tag[TAG],uint8_t* out) const = 0;
+};
+
+// ---------- AES-256-GCM ----------
+// NIST SP 800-38D with a 96-bit nonce and a 128-bit tag. The AES-NI + PCLMULQDQ path
+// runs CTR four blocks at a time and folds four GHASH blocks per reduction; the portable
+// path (table S-box, bitwise GF(2^128) multiply) is the reference and the fallback.
+class AesGcm : public Aead {
+public:
+    static bool hardwareAvailable(){ const Cpu& c=Cpu::get(); return c.aes && c.pclmul && c.ssse3 && c.sse41; }
+
+    explicit AesGcm(const uint8_t key[KEY],bool allowHardware=true):hw(allowHardware && hardwareAvailable()){
+        expandKey(key);
+        uint8_t zero[16]={0}; encryptBlock(zero,hkey);
+        hHi=load64be(hkey); hLo=load64be(hkey+8);
+#ifdef V7_X86
+        if(hw) hwInit();
+#endif
+    }
+    ~AesGcm(){ wipe(rk,sizeof(rk)); wipe(hkey,sizeof(hkey)); wipe(hpow,sizeof(hpow)); hHi=hLo=0; }
+    AesGcm(const AesGcm&)=delete; AesGcm& operator=(const AesGcm&)=delete;
+    bool hardware() const { return hw; }
+    const char* name() const override { return "aes-256-gcm"; }
+    const char* kernel() const override { return hw? "aes-ni" : "portable"; }
+
+    void seal(const uint8_t nonce[NONCE],const uint8_t* aad,size_t aadLen,const uint8_t* in,size_t n,uint8_t* out,uint8_t tag[TAG]) const override {
+        ctr(nonce,in,n,out);
+        computeTag(nonce,aad,aadLen,out,n,tag);
+    }
+    bool open(const uint8_t nonce[NONCE],const uint8_t* aad,size_t aadLen,const uint8_t* in,size_t n,const uint8_t tag[TAG],uint8_t* out) const override {
+        uint8_t want[TAG]; computeTag(nonce,aad,aadLen,in,n,want);
+        bool ok=equal(want,tag,TAG);
+        if(ok) ctr(nonce,in,n,out);
+        return ok;
+    }
+
+private:
+    alignas(16) uint8_t rk[15*16];
+    alignas(16) uint8_t hkey[16];
+    alignas(16) uint8_t hpow[4*16];   // H^1..H^4, byte-reversed, for the PCLMUL path
+    uint64_t hHi=0, hLo=0;
+    bool hw;
+
+    static const uint8_t* sbox(){
+        static const struct T { uint8_t s[256]; T(){
+            // multiplicative inverse via log/antilog walk over generator 3, then the affine map
+            uint8_t p=1, q=1;
+            do {
+                p=uint8_t(p ^ (p<<1) ^ ((p&0x80)? 0x1B : 0));
+                q^=q<<1; q^=q<<2; q^=q<<4; if(q&0x80) q^=0x09;
+                uint8_t x=uint8_t(q ^ (q<<1|q>>7) ^ (q<<2|q>>6) ^ (q<<3|q>>5) ^ (q<<4|q>>4));
+                s[p]=x^0x63;
+            } while(p!=1);
+            s[0]=0x63;
+        } } t;
+        return t.s;
+    }
+    void expandKey(const uint8_t key[KEY]){
+        const uint8_t* S=sbox();
+        memcpy(rk,key,32);
+        uint8_t rcon=1;
+        for(int i=8;i<60;++i){
+            uint8_t t[4]; memcpy(t,rk+4*(i-1),4);
+            if(i%8==0){
+                uint8_t u=t[0]; t[0]=uint8_t(S[t[1]]^rcon); t[1]=S[t[2]]; t[2]=S[t[3]]; t[3]=S[u];
+                rcon=uint8_t(rcon<<1 ^ ((rcon&0x80)? 0x1B : 0));
+            } else if(i%8==4){ for(auto& b: t) b=S[b]; }
+            for(int j=0;j<4;++j) rk[4*i+j]=rk[4*(i-8)+j]^t[j];
+        }
+    }
+    void encryptBlock(const uint8_t in[16],uint8_t out[16]) const {
+        const uint8_t* S=sbox();
+        uint8_t s[16], t[16];
+        for(int i=0;i<16;++i) s[i]=in[i]^rk[i];
+        for(int r=1;r<=14;++r){
+            for(int c=0;c<4;++c) for(int row=0;row<4;++row) t[row+4*c]=S[s[row+4*((c+row)&3)]];
+            if(r<14) for(int c=0;c<4;++c){
+                uint8_t* a=t+4*c; uint8_t a0=a[0],a1=a[1],a2=a[2],a3=a[3], all=a0^a1^a2^a3;
+                auto xt=[](uint8_t x){ return uint8_t(x<<1 ^ ((x>>7)*0x1B)); };
+                a[0]^=all^xt(a0^a1); a[1]^=all^xt(a1^a2); a[2]^=all^xt(a2^a3); a[3]^=all^xt(a3^a0);
+            }
+            for(int i=0;i<16;++i) s[i]=t[i]^rk[16*r+i];
+        }
+        memcpy(out,s,16);
+        wipe(s,16); wipe(t,16);
+    }
+    // GF(2^128) multiply in GCM bit order, constant time: x = x*H.
+    void gmul(uint64_t& xHi,uint64_t& xLo) const {
+        uint64_t zHi=0, zLo=0, vHi=hHi, vLo=hLo;
+        for(int i=0;i<128;++i){
+            uint64_t bit = i<64? (xHi>>(63-i))&1 : (xLo>>(127-i))&1;
+            uint64_t m=0-bit; zHi^=vHi&m; zLo^=vLo&m;
+            uint64_t lsb=0-(vLo&1);
+            vLo=(vLo>>1)|(vHi<<63); vHi=(vHi>>1)^(0xE100000000000000ull&lsb);
+        }
+        xHi=zHi; xLo=zLo;
+    }
+    void ghashPortable(uint64_t& xHi,uint64_t& xLo,const uint8_t* p,size_t n) const {
+        for(; n; ){
+            uint8_t b[16]={0}; size_t k=std::min<size_t>(n,16); memcpy(b,p,k);
+            xHi^=load64be(b); xLo^=load64be(b+8); gmul(xHi,xLo);
+            p+=k; n-=k;
+        }
+    }
+    void ctrPortable(const uint8_t nonce[NONCE],const uint8_t* in,size_t n,uint8_t* out) const {
+        uint8_t cb[16], ks[16]; memcpy(cb,nonce,12);
+        for(uint32_t ctr=2; n; ++ctr){
+            store32be(cb+12,ctr); encryptBlock(cb,ks);
+            size_t k=std::min<size_t>(n,16);
+            for(size_t i=0;i<k;++i) out[i]=in[i]^ks[i];
+            in+=k; out+=k; n-=k;
+        }
+        wipe(ks,16);
+    }
+    void ctr(const uint8_t nonce[NONCE],const uint8_t* in,size_t n,uint8_t* out) const {
+#ifdef V7_X86
+        if(hw){ ctrHw(nonce,in,n,out); return; }
+#endif
+        ctrPortable(nonce,in,n,out);
+    }
+    void computeTag(const uint8_t nonce[NONCE],const uint8_t* aad,size_t aadLen,const uint8_t* c,size_t n,uint8_t tag[TAG]) const {
+        uint8_t lens[16]; store64be(lens,(uint64_t)aadLen*8); store64be(lens+8,(uint64_t)n*8);
+        uint8_t s[16];
+#ifdef V7_X86
+        if(hw) ghashHw(aad,aadLen,c,n,lens,s); else
+#endif
+        {
+            uint64_t xHi=0, xLo=0;
+            ghashPortable(xHi,xLo,aad,aadLen); ghashPortable(xHi,xLo,c,n); ghashPortable(xHi,xLo,lens,16);
+            store64be(s,xHi); store64be(s+8,xLo);
+        }
+        uint8_t j0[16], ek[16]; memcpy(j0,nonce,12); store32be(j0+12,1);
+        encryptBlock(j0,ek);
+        for(int i=0;i<16;++i) tag[i]=s[i]^ek[i];
+        wipe(ek,16);
+    }
+
+#ifdef V7_X86
+    V7_TARGET("ssse3") static __m128i bswap(__m128i x){ return _mm_shuffle_epi8(x,_mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15)); }
+    // 256-bit carry-less product, accumulated into lo/hi (no reduction yet).
+    V7_TARGET("pclmul,sse2") static void clmulAcc(__m128i a,__m128i b,__m128i& lo,__m128i& hi){
+        __m128i t0=_mm_clmulepi64_si128(a,b,0x00), t1=_mm_clmulepi64_si128(a,b,0x10);
+        __m128i t2=_mm_clmulepi64_si128(a,b,0x01), t3=_mm_clmulepi64_si128(a,b,0x11);
+        t1=_mm_xor_si128(t1,t2);
+        lo=_mm_xor_si128(lo,_mm_xor_si128(t0,_mm_slli_si128(t1,8)));
+        hi=_mm_xor_si128(hi,_mm_xor_si128(t3,_mm_srli_si128(t1,8)));
+    }
+    // Shift the reflected product left by one and reduce mod x^128+x^7+x^2+x+1.
+    V7_TARGET("sse2") static __m128i reduce(__m128i lo,__m128i hi){
+        __m128i t7=_mm_srli_epi32(lo,31), t8=_mm_srli_epi32(hi,31);
+        lo=_mm_slli_epi32(lo,1); hi=_mm_slli_epi32(hi,1);
+        __m128i t9=_mm_srli_si128(t7,12);
+        t8=_mm_slli_si128(t8,4); t7=_mm_slli_si128(t7,4);
+        lo=_mm_or_si128(lo,t7); hi=_mm_or_si128(_mm_or_si128(hi,t8),t9);
+        t7=_mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo,31),_mm_slli_epi32(lo,30)),_mm_slli_epi32(lo,25));
+        t8=_mm_srli_si128(t7,4); t7=_mm_slli_si128(t7,12);
+        lo=_mm_xor_si128(lo,t7);
+        __m128i t2=_mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo,1),_mm_srli_epi32(lo,2)),_mm_srli_epi32(lo,7));
+        t2=_mm_xor_si128(t2,t8);
+        lo=_mm_xor_si128(lo,t2);
+        return _mm_xor_si128(hi,lo);
+    }
+    V7_TARGET("pclmul,ssse3") static __m128i gfmul(__m128i a,__m128i b){ __m128i lo=_mm_setzero_si128(), hi=lo; clmulAcc(a,b,lo,hi); return reduce(lo,hi); }
+    V7_TARGET("pclmul,ssse3") void hwInit(){
+        __m128i h=bswap(_mm_load_si128((const __m128i*)hkey)), p=h;
+        for(int i=0;i<4;++i){ _mm_store_si128((__m128i*)(hpow+16*i),p); p=gfmul(p,h); }
+    }
+    V7_TARGET("pclmul,ssse3") __m128i ghashBlocks(__m128i x,const uint8_t* p,size_t n) const {
+        const __m128i h1=_mm_load_si128((const __m128i*)hpow), h2=_mm_load_si128((const __m128i*)(hpow+16));
+        const __m128i h3=_mm_load_si128((const __m128i*)(hpow+32)), h4=_mm_load_si128((const __m128i*)(hpow+48));
+        for(; n>=64; p+=64, n-=64){
+            __m128i lo=_mm_setzero_si128(), hi=lo;
+            clmulAcc(_mm_xor_si128(x,bswap(_mm_loadu_si128((const __m128i*)p))),h4,lo,hi);
+            clmulAcc(bswap(_mm_loadu_si128((const __m128i*)(p+16))),h3,lo,hi);
+            clmulAcc(bswap(_mm_loadu_si128((const __m128i*)(p+32))),h2,lo,hi);
+            clmulAcc(bswap(_mm_loadu_si128((const __m128i*)(p+48))),h1,lo,hi);
+            x=reduce(lo,hi);
+        }
+        for(; n; ){
+            alignas(16) uint8_t b[16]={0}; size_t k=std::min<size_t>(n,16); memcpy(b,p,k);
+            x=gfmul(_mm_xor_si128(x,bswap(_mm_load_si128((const __m128i*)b))),h1);
+            p+=k; n-=k;
+        }
+        return x;
+    }
+    V7_TARGET("pclmul,ssse3") void ghashHw(const uint8_t* aad,size_t aadLen,const uint8_t* c,size_t n,const uint8_t lens[16],uint8_t out[16]) const {
+        __m128i x=_mm_setzero_si128();
+        x=ghashBlocks(x,aad,aadLen); x=ghashBlocks(x,c,n); x=ghashBlocks(x,lens,16);
+        _mm_storeu_si128((__m128i*)out,bswap(x));
+    }
+    V7_TARGET("sse4.1") static __m128i counterBlock(__m128i base,uint32_t ctr){ return _mm_insert_epi32(base,(int)bswap32(ctr),3); }
+    V7_TARGET("aes,sse4.1") void ctrHw(const uint8_t nonce[NONCE],const uint8_t* in,size_t n,uint8_t* out) const {
+        __m128i k[15];
+        for(int i=0;i<15;++i) k[i]=_mm_load_si128((const __m128i*)(rk+16*i));
+        alignas(16) uint8_t base[16]={0}; memcpy(base,nonce,12);
+        const __m128i cb=_mm_load_si128((const __m128i*)base);
+        uint32_t ctr=2;
+        for(; n>=64; in+=64, out+=64, n-=64, ctr+=4){
+            __m128i b0=_mm_xor_si128(counterBlock(cb,ctr),k[0]), b1=_mm_xor_si128(counterBlock(cb,ctr+1),k[0]);
+            __m128i b2=_mm_xor_si128(counterBlock(cb,ctr+2),k[0]), b3=_mm_xor_si128(counterBlock(cb,ctr+3),k[0]);
+            for(int r=1;r<14;++r){ b0=_mm_aesenc_si128(b0,k[r]); b1=_mm_aesenc_si128(b1,k[r]); b2=_mm_aesenc_si128(b2,k[r]); b3=_mm_aesenc_si128(b3,k[r]); }
+            b0=_mm_aesenclast_si128(b0,k[14]); b1=_mm_aesenclast_si128(b1,k[14]); b2=_mm_aesenclast_si128(b2,k[14]); b3=_mm_aesenclast_si128(b3,k[14]);
+            _mm_storeu_si128((__m128i*)out,     _mm_xor_si128(b0,_mm_loadu_si128((const __m128i*)in)));
+            _mm_storeu_si128((__m128i*)(out+16),_mm_xor_si128(b1,_mm_loadu_si128((const __m128i*)(in+16))));
+            _mm_storeu_si128((__m128i*)(out+32),_mm_xor_si128(b2,_mm_loadu_si128((const __m128i*)(in+32))));
+            _mm_storeu_si128((__m128i*)(out+48),_mm_xor_si128(b3,_mm_loadu_si128((const __m128i*)(in+48))));
+        }
+        for(; n; ++ctr){
+            __m128i b=_mm_xor_si128(counterBlock(cb,ctr),k[0]);
+            for(int r=1;r<14;++r) b=_mm_aesenc_si128(b,k[r]);
+            b=_mm_aesenclast_si128(b,k[14]);
+            alignas(16) uint8_t ks[16]; _mm_store_si128((__m128i*)ks,b);
+            size_t m=std::min<size_t>(n,16);
+            for(size_t i=0;i<m;++i) out[i]=in[i]^ks[i];
+            wipe(ks,16); in+=m; out+=m; n-=m;
+        }
+    }
+#endif
+};
+
+// ---------- CHACHA20-POLY1305 ----------
+// RFC 8439. ChaCha20 has a scalar reference and SSE2 (4 blocks) / AVX2 (8 blocks)
+// kernels that run one block per vector lane; Poly1305 is the 26-bit-limb scalar form.
+// No table lookups anywhere, so it is constant time without AES-NI.
+class ChaCha20Poly1305 : public Aead {
+public:
+    enum class Kernel : uint8_t { Scalar, SSE2, AVX2 };
+    static Kernel best(){ const Cpu& c=Cpu::get(); return c.avx2? Kernel::AVX2 : c.sse2? Kernel::SSE2 : Kernel::Scalar; }
+
+    explicit ChaCha20Poly1305(const uint8_t key[KEY],Kernel k=best()):kern(k){ for(int i=0;i<8;++i) kw[i]=load32le(key+4*i); }
+    ~ChaCha20Poly1305(){ wipe(kw,sizeof(kw)); }
+    ChaCha20Poly1305(const ChaCha20Poly1305&)=delete; ChaCha20Poly1305& operator=(const ChaCha20Poly1305&)=delete;
+    const char* name() const override { return "chacha20-poly1305"; }
+    const char* kernel() const override { return kern==Kernel::AVX2? "avx2" : kern==Kernel::SSE2? "sse2" : "scalar"; }
+
+    void seal(const uint8_t nonce[NONCE],const uint8_t* aad,size_t aadLen,const uint8_t* in,size_t n,uint8_t* out,uint8_t tag[TAG]) const override {
+        xorStream(nonce,1,in,n,out);
+        computeTag(nonce,aad,aadLen,out,n,tag);
+    }
+    bool open(const uint8_t nonce[NONCE],const uint8_t* aad,size_t aadLen,const uint8_t* in,size_t n,const uint8_t tag[TAG],uint8_t* out) const override {
+        uint8_t want[TAG]; computeTag(nonce,aad,aadLen,in,n,want);
+        bool ok=equal(want,tag,TAG);
+        if(ok) xorStream(nonce,1,in,n,out);
+        return ok;
+    }
+
+private:
+    uint32_t kw[8];
+    Kernel kern;
+
+    static uint32_t load32le(const uint8_t* p){ return (uint32_t)p[0] | (uint32_t)p[1]<<8 | (uint32_t)p[2]<<16 | (uint32_t)p[3]<<24; }
+    static void store32le(uint8_t* p,uint32_t v){ p[0]=uint8_t(v); p[1]=uint8_t(v>>8); p[2]=uint8_t(v>>16); p[3]=uint8_t(v>>24); }
+    static uint64_t load64le(const uint8_t* p){ return (uint64_t)load32le(p+4)<<32 | load32le(p); }
+    static void store64le(uint8_t* p,uint64_t v){ store32le(p,uint32_t(v)); store32le(p+4,uint32_t(v>>32)); }
+    static uint32_t rotl(uint32_t x,int n){ return x<<n | x>>(32-n); }
+    void initState(uint32_t st[16],const uint8_t nonce[NONCE],uint32_t counter) const {
+        st[0]=0x61707865; st[1]=0x3320646e; st[2]=0x79622d32; st[3]=0x6b206574;
+        for(int i=0;i<8;++i) st[4+i]=kw[i];
+        st[12]=counter; st[13]=load32le(nonce); st[14]=load32le(nonce+4); st[15]=load32le(nonce+8);
+    }
+    static void block(const uint32_t st[16],uint8_t out[64]){
+        uint32_t x[16]; memcpy(x,st,sizeof(x));
+        auto qr=[&](int a,int b,int c,int d){
+            x[a]+=x[b]; x[d]=rotl(x[d]^x[a],16); x[c]+=x[d]; x[b]=rotl(x[b]^x[c],12);
+            x[a]+=x[b]; x[d]=rotl(x[d]^x[a],8);  x[c]+=x[d]; x[b]=rotl(x[b]^x[c],7);
+        };
+        for(int i=0;i<10;++i){ qr(0,4,8,12); qr(1,5,9,13); qr(2,6,10,14); qr(3,7,11,15); qr(0,5,10,15); qr(1,6,11,12); qr(2,7,8,13); qr(3,4,9,14); }
+        for(int i=0;i<16;++i) store32le(out+4*i,x[i]+st[i]);
+        wipe(x,sizeof(x));
+    }
+    // Keystream from block `counter` on, xored into in; the vector kernels take the bulk.
+    void xorStream(const uint8_t nonce[NONCE],uint32_t counter,const uint8_t* in,size_t n,uint8_t* out) const {
+        uint32_t st[16]; initState(st,nonce,counter);
+#ifdef V7_X86
+        if(kern==Kernel::AVX2) for(; n>=512; in+=512, out+=512, n-=512, st[12]+=8) blocks8(st,in,out);
+        if(kern!=Kernel::Scalar) for(; n>=256; in+=256, out+=256, n-=256, st[12]+=4) blocks4(st,in,out);
+#endif
+        uint8_t ks[64];
+        for(; n; ++st[12]){
+            block(st,ks);
+            size_t k=std::min<size_t>(n,64);
+            for(size_t i=0;i<k;++i) out[i]=in[i]^ks[i];
+            in+=k; out+=k; n-=k;
+        }
+        wipe(ks,sizeof(ks)); wipe(st,sizeof(st));
+    }
+
+    // Poly1305 accumulator: 44-bit limbs where the compiler has 128-bit products,
+    // 26-bit limbs (poly1305-donna-32) otherwise. Every block is full: the AEAD layout
+    // zero-pads aad and ciphertext to 16 bytes, so the 2^128 bit is always set.
+    struct Poly1305 {
+#ifdef __SIZEOF_INT128__
+        uint64_t r0,r1,r2,s1,s2,h0=0,h1=0,h2=0,pad[2];
+        explicit Poly1305(const uint8_t k[32]){
+            uint64_t t0=load64le(k), t1=load64le(k+8);
+            r0=t0&0xffc0fffffff; r1=(t0>>44|t1<<20)&0xfffffc0ffff; r2=t1>>24&0x00ffffffc0f;
+            s1=r1*20; s2=r2*20; pad[0]=load64le(k+16); pad[1]=load64le(k+24);
+        }
+        ~Poly1305(){ wipe(this,sizeof(*this)); }
+        void block(const uint8_t m[16]){
+            typedef unsigned __int128 u128;
+            uint64_t t0=load64le(m), t1=load64le(m+8);
+            h0+=t0&0xfffffffffff; h1+=(t0>>44|t1<<20)&0xfffffffffff; h2+=(t1>>24&0x3ffffffffff)|1ull<<40;
+            u128 d0=(u128)h0*r0+(u128)h1*s2+(u128)h2*s1, d1=(u128)h0*r1+(u128)h1*r0+(u128)h2*s2, d2=(u128)h0*r2+(u128)h1*r1+(u128)h2*r0;
+            uint64_t c=uint64_t(d0>>44); h0=uint64_t(d0)&0xfffffffffff;
+            d1+=c; c=uint64_t(d1>>44); h1=uint64_t(d1)&0xfffffffffff;
+            d2+=c; c=uint64_t(d2>>42); h2=uint64_t(d2)&0x3ffffffffff;
+            h0+=c*5; c=h0>>44; h0&=0xfffffffffff; h1+=c;
+        }
+        void finish(uint8_t tag[16]){
+            uint64_t c;
+            c=h1>>44; h1&=0xfffffffffff; h2+=c; c=h2>>42; h2&=0x3ffffffffff; h0+=c*5; c=h0>>44; h0&=0xfffffffffff;
+            h1+=c; c=h1>>44; h1&=0xfffffffffff; h2+=c; c=h2>>42; h2&=0x3ffffffffff; h0+=c*5; c=h0>>44; h0&=0xfffffffffff; h1+=c;
+            uint64_t g0=h0+5; c=g0>>44; g0&=0xfffffffffff;
+            uint64_t g1=h1+c; c=g1>>44; g1&=0xfffffffffff;
+            uint64_t g2=h2+c-(1ull<<42);
+            uint64_t keep=(g2>>63)-1;   // all ones when h >= p
+            h0=(h0&~keep)|(g0&keep); h1=(h1&~keep)|(g1&keep); h2=(h2&~keep)|(g2&keep);
+            h0+=pad[0]&0xfffffffffff; c=h0>>44; h0&=0xfffffffffff;
+            h1+=((pad[0]>>44|pad[1]<<20)&0xfffffffffff)+c; c=h1>>44; h1&=0xfffffffffff;
+            h2+=(pad[1]>>24)+c; h2&=0x3ffffffffff;
+            store64le(tag,h0|h1<<44); store64le(tag+8,h1>>20|h2<<24);
+        }
+#else
+        uint32_t r0,r1,r2,r3,r4,s1,s2,s3,s4,h0=0,h1=0,h2=0,h3=0,h4=0,pad[4];
+        explicit Poly1305(const uint8_t k[32]){
+            r0=load32le(k)&0x3ffffff; r1=load32le(k+3)>>2&0x3ffff03; r2=load32le(k+6)>>4&0x3ffc0ff; r3=load32le(k+9)>>6&0x3f03fff; r4=load32le(k+12)>>8&0x00fffff;
+            s1=r1*5; s2=r2*5; s3=r3*5; s4=r4*5;
+            for(int i=0;i<4;++i) pad[i]=load32le(k+16+4*i);
+        }
+        ~Poly1305(){ wipe(this,sizeof(*this)); }
+        void block(const uint8_t m[16]){
+            h0+=load32le(m)&0x3ffffff; h1+=load32le(m+3)>>2&0x3ffffff; h2+=load32le(m+6)>>4&0x3ffffff; h3+=load32le(m+9)>>6&0x3ffffff; h4+=load32le(m+12)>>8 | 1u<<24;
+            uint64_t d0=(uint64_t)h0*r0+(uint64_t)h1*s4+(uint64_t)h2*s3+(uint64_t)h3*s2+(uint64_t)h4*s1;
+            uint64_t d1=(uint64_t)h0*r1+(uint64_t)h1*r0+(uint64_t)h2*s4+(uint64_t)h3*s3+(uint64_t)h4*s2;
+            uint64_t d2=(uint64_t)h0*r2+(uint64_t)h1*r1+(uint64_t)h2*r0+(uint64_t)h3*s4+(uint64_t)h4*s3;
+            uint64_t d3=(uint64_t)h0*r3+(uint64_t)h1*r2+(uint64_t)h2*r1+(uint64_t)h3*r0+(uint64_t)h4*s4;
+            uint64_t d4=(uint64_t)h0*r4+(uint64_t)h1*r3+(uint64_t)h2*r2+(uint64_t)h3*r1+(uint64_t)h4*r0;
+            d1+=d0>>26; h0=uint32_t(d0)&0x3ffffff;
+            d2+=d1>>26; h1=uint32_t(d1)&0x3ffffff;
+            d3+=d2>>26; h2=uint32_t(d2)&0x3ffffff;
+            d4+=d3>>26; h3=uint32_t(d3)&0x3ffffff;
+            uint32_t carry=uint32_t(d4>>26); h4=uint32_t(d4)&0x3ffffff;
+            h0+=carry*5; h1+=h0>>26; h0&=0x3ffffff;
+        }
+        void finish(uint8_t tag[16]){
+            uint32_t c;
+            c=h1>>26; h1&=0x3ffffff; h2+=c; c=h2>>26; h2&=0x3ffffff; h3+=c; c=h3>>26; h3&=0x3ffffff;
+            h4+=c; c=h4>>26; h4&=0x3ffffff; h0+=c*5; c=h0>>26; h0&=0x3ffffff; h1+=c;
+            uint32_t g0=h0+5; c=g0>>26; g0&=0x3ffffff;
+            uint32_t g1=h1+c; c=g1>>26; g1&=0x3ffffff;
+            uint32_t g2=h2+c; c=g2>>26; g2&=0x3ffffff;
+            uint32_t g3=h3+c; c=g3>>26; g3&=0x3ffffff;
+            uint32_t g4=h4+c-(1u<<26);
+            uint32_t keep=(g4>>31)-1;   // all ones when h >= p
+            h0=(h0&~keep)|(g0&keep); h1=(h1&~keep)|(g1&keep); h2=(h2&~keep)|(g2&keep); h3=(h3&~keep)|(g3&keep); h4=(h4&~keep)|(g4&keep);
+            uint64_t f;
+            f=(uint64_t)(h0|h1<<26)+pad[0];            store32le(tag,uint32_t(f));
+            f=(uint64_t)(h1>>6|h2<<20)+pad[1]+(f>>32); store32le(tag+4,uint32_t(f));
+            f=(uint64_t)(h2>>12|h3<<14)+pad[2]+(f>>32);store32le(tag+8,uint32_t(f));
+            f=(uint64_t)(h3>>18|h4<<8)+pad[3]+(f>>32); store32le(tag+12,uint32_t(f));
+        }
+#endif
+        void update(const uint8_t* p,size_t n){
+            for(; n>=16; p+=16, n-=16) block(p);
+            if(n){ uint8_t b[16]={0}; memcpy(b,p,n); block(b); }
+        }
+    };
+    // Poly1305 over aad | pad16 | ciphertext | pad16 | le64(aadLen) | le64(n), keyed by
+    // the first 32 bytes of keystream block 0.
+    void computeTag(const uint8_t nonce[NONCE],const uint8_t* aad,size_t aadLen,const uint8_t* c,size_t n,uint8_t tag[TAG]) const {
+        uint32_t st[16]; initState(st,nonce,0);
+        uint8_t otk[64]; block(st,otk);
+        Poly1305 mac(otk);
+        mac.update(aad,aadLen); mac.update(c,n);
+        uint8_t lens[16]; store64le(lens,aadLen); store64le(lens+8,n);
+        mac.block(lens); mac.finish(tag);
+        wipe(otk,sizeof(otk)); wipe(st,sizeof(st));
+    }
+
+#ifdef V7_X86
+    // 4x4 transpose: word w+i of blocks 0..3 in a[i] -> words w..w+3 of block b in a[b]
+    // (per 128-bit half for the AVX2 form).
+    V7_TARGET("sse2") static void transpose(__m128i* a){
+        __m128i t0=_mm_unpacklo_epi32(a[0],a[1]), t1=_mm_unpacklo_epi32(a[2],a[3]), t2=_mm_unpackhi_epi32(a[0],a[1]), t3=_mm_unpackhi_epi32(a[2],a[3]);
+        a[0]=_mm_unpacklo_epi64(t0,t1); a[1]=_mm_unpackhi_epi64(t0,t1); a[2]=_mm_unpacklo_epi64(t2,t3); a[3]=_mm_unpackhi_epi64(t2,t3);
+    }
+    V7_TARGET("avx2") static void transpose(__m256i* a){
+        __m256i t0=_mm256_unpacklo_epi32(a[0],a[1]), t1=_mm256_unpacklo_epi32(a[2],a[3]), t2=_mm256_unpackhi_epi32(a[0],a[1]), t3=_mm256_unpackhi_epi32(a[2],a[3]);
+        a[0]=_mm256_unpacklo_epi64(t0,t1); a[1]=_mm256_unpackhi_epi64(t0,t1); a[2]=_mm256_unpacklo_epi64(t2,t3); a[3]=_mm256_unpackhi_epi64(t2,t3);
+    }
+#define V7_QR(A,B,C,D,ADD,XOR,ROT) \
+    A=ADD(A,B); D=ROT(XOR(D,A),16); C=ADD(C,D); B=ROT(XOR(B,C),12); \
+    A=ADD(A,B); D=ROT(XOR(D,A),8);  C=ADD(C,D); B=ROT(XOR(B,C),7);
+#define V7_DOUBLEROUND(x,ADD,XOR,ROT) \
+    V7_QR(x[0],x[4],x[8],x[12],ADD,XOR,ROT) V7_QR(x[1],x[5],x[9],x[13],ADD,XOR,ROT) \
+    V7_QR(x[2],x[6],x[10],x[14],ADD,XOR,ROT) V7_QR(x[3],x[7],x[11],x[15],ADD,XOR,ROT) \
+    V7_QR(x[0],x[5],x[10],x[15],ADD,XOR,ROT) V7_QR(x[1],x[6],x[11],x[12],ADD,XOR,ROT) \
+    V7_QR(x[2],x[7],x[8],x[13],ADD,XOR,ROT) V7_QR(x[3],x[4],x[9],x[14],ADD,XOR,ROT)
+
+    // Four blocks, one per 32-bit lane: 256 bytes of keystream xored into in.
+    V7_TARGET("sse2") static void blocks4(const uint32_t st[16],const uint8_t* in,uint8_t* out){
+#define V7_ROT128(v,n) _mm_or_si128(_mm_slli_epi32(v,n),_mm_srli_epi32(v,32-(n)))
+        __m128i x[16], s[16];
+        for(int i=0;i<16;++i) s[i]=_mm_set1_epi32((int)st[i]);
+        s[12]=_mm_add_epi32(s[12],_mm_set_epi32(3,2,1,0));
+        for(int i=0;i<16;++i) x[i]=s[i];
+        for(int r=0;r<10;++r){ V7_DOUBLEROUND(x,_mm_add_epi32,_mm_xor_si128,V7_ROT128) }
+        for(int i=0;i<16;++i) x[i]=_mm_add_epi32(x[i],s[i]);
+        for(int g=0;g<4;++g){
+            __m128i* a=x+4*g; transpose(a);
+            for(int b=0;b<4;++b){
+                size_t off=64*b+16*g;
+                _mm_storeu_si128((__m128i*)(out+off),_mm_xor_si128(a[b],_mm_loadu_si128((const __m128i*)(in+off))));
+            }
+        }
+#undef V7_ROT128
+    }
+    // Eight blocks, one per lane: lanes 0-3 in the low halves, 4-7 in the high halves.
+    V7_TARGET("avx2") static void blocks8(const uint32_t st[16],const uint8_t* in,uint8_t* out){
+#define V7_ROT256(v,n) _mm256_or_si256(_mm256_slli_epi32(v,n),_mm256_srli_epi32(v,32-(n)))
+        __m256i x[16], s[16];
+        for(int i=0;i<16;++i) s[i]=_mm256_set1_epi32((int)st[i]);
+        s[12]=_mm256_add_epi32(s[12],_mm256_set_epi32(7,6,5,4,3,2,1,0));
+        for(int i=0;i<16;++i) x[i]=s[i];
+        for(int r=0;r<10;++r){ V7_DOUBLEROUND(x,_mm256_add_epi32,_mm256_xor_si256,V7_ROT256) }
+        for(int i=0;i<16;++i) x[i]=_mm256_add_epi32(x[i],s[i]);
+        for(int g=0;g<4;++g) transpose(x+4*g);
+        // x[4g+b] now holds group g (words 4g..4g+3) of block b low, block b+4 high
+        for(int b=0;b<4;++b) for(int g=0;g<4;g+=2){
+            __m256i lo=_mm256_permute2x128_si256(x[4*g+b],x[4*(g+1)+b],0x20), hi=_mm256_permute2x128_si256(x[4*g+b],x[4*(g+1)+b],0x31);
+            size_t offLo=64*b+16*g, offHi=64*(b+4)+16*g;
+            _mm256_storeu_si256((__m256i*)(out+offLo),_mm256_xor_si256(lo,_mm256_loadu_si256((const __m256i*)(in+offLo))));
+            _mm256_storeu_si256((__m256i*)(out+offHi),_mm256_xor_si256(hi,_mm256_loadu_si256((const __m256i*)(in+offHi))));
+        }
+#undef V7_ROT256
+    }
+#undef V7_DOUBLEROUND
+#undef V7_QR
+#endif
+};
+
+// ---------- BLAKE2B ----------
+// RFC 7693, unkeyed, 1..64-byte digests; the hash inside Argon2.
+class Blake2b {
+    uint64_t h[8], t=0; uint8_t buf[128]; size_t used=0, outLen;
+    static uint64_t rotr(uint64_t x,int n){ return x>>n | x<<(64-n); }
+    static uint64_t load64le(const uint8_t* p){ uint64_t v=0; for(int i=7;i>=0;--i) v=v<<8|p[i]; return v; }
+    static const uint64_t* iv(){ static const uint64_t v[8]={0x6a09e667f3bcc908ull,0xbb67ae8584caa73bull,0x3c6ef372fe94f82bull,0xa54ff53a5f1d36f1ull,0x510e527fade682d1ull,0x9b05688c2b3e6c1full,0x1f83d9abfb41bd6bull,0x5be0cd19137e2179ull}; return v; }
+    void compress(const uint8_t* p,bool last){
+        static const uint8_t sigma[12][16]={
+            {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15},{14,10,4,8,9,15,13,6,1,12,0,2,11,7,5,3},{11,8,12,0,5,2,15,13,10,14,3,6,7,1,9,4},
+            {7,9,3,1,13,12,11,14,2,6,5,10,4,0,15,8},{9,0,5,7,2,4,10,15,14,1,11,12,6,8,3,13},{2,12,6,10,0,11,8,3,4,13,7,5,15,14,1,9},
+            {12,5,1,15,14,13,4,10,0,7,6,3,9,2,8,11},{13,11,7,14,12,1,3,9,5,0,15,4,8,6,2,10},{6,15,14,9,11,3,0,8,12,2,13,7,1,4,10,5},
+            {10,2,8,4,7,6,1,5,15,11,9,14,3,12,13,0},{0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15},{14,10,4,8,9,15,13,6,1,12,0,2,11,7,5,3} };
+        uint64_t m[16], v[16];
+        for(int i=0;i<16;++i) m[i]=load64le(p+8*i);
+        for(int i=0;i<8;++i){ v[i]=h[i]; v[8+i]=iv()[i]; }
+        v[12]^=t; if(last) v[14]=~v[14];
+        auto g=[&](int a,int b,int c,int d,uint64_t x,uint64_t y){
+            v[a]+=v[b]+x; v[d]=rotr(v[d]^v[a],32); v[c]+=v[d]; v[b]=rotr(v[b]^v[c],24);
+            v[a]+=v[b]+y; v[d]=rotr(v[d]^v[a],16); v[c]+=v[d]; v[b]=rotr(v[b]^v[c],63);
+        };
+        for(int r=0;r<12;++r){
+            const uint8_t* s=sigma[r];
+            g(0,4,8,12,m[s[0]],m[s[1]]); g(1,5,9,13,m[s[2]],m[s[3]]); g(2,6,10,14,m[s[4]],m[s[5]]); g(3,7,11,15,m[s[6]],m[s[7]]);
+            g(0,5,10,15,m[s[8]],m[s[9]]); g(1,6,11,12,m[s[10]],m[s[11]]); g(2,7,8,13,m[s[12]],m[s[13]]); g(3,4,9,14,m[s[14]],m[s[15]]);
+        }
+        for(int i=0;i<8;++i) h[i]^=v[i]^v[8+i];
+        wipe(m,sizeof(m)); wipe(v,sizeof(v));
+    }
+public:
+    explicit Blake2b(size_t outLen=64):outLen(outLen){ for(int i=0;i<8;++i) h[i]=iv()[i]; h[0]^=0x01010000u^outLen; }
+    ~Blake2b(){ wipe(h,sizeof(h)); wipe(buf,sizeof(buf)); }
+    Blake2b& update(const void* data,size_t n){
+        const uint8_t* p=(const uint8_t*)data;
+        while(n){
+            if(used==128){ t+=128; compress(buf,false); used=0; }   // only once more input follows
+            size_t k=std::min(n,128-used); memcpy(buf+used,p,k); used+=k; p+=k; n-=k;
+        }
+        return *this;
+    }
+    Blake2b& update32(uint32_t v){ uint8_t b[4]={uint8_t(v),uint8_t(v>>8),uint8_t(v>>16),uint8_t(v>>24)}; return update(b,4); }
+    void final(uint8_t* out){
+        t+=used; memset(buf+used,0,128-used); compress(buf,true);
+        uint8_t full[64]; for(int i=0;i<8;++i) for(int j=0;j<8;++j) full[8*i+j]=uint8_t(h[i]>>(8*j));
+        memcpy(out,full,outLen); wipe(full,sizeof(full));
+    }
+};
+
+// ---------- ARGON2ID ----------
+// RFC 9106 (version 0x13). Lanes of each slice are filled on their own threads; memory
+// is memoryKiB 1 KiB blocks, so 64 MiB at the default.
+class Argon2id {
+public:
+    struct Params { uint32_t memoryKiB=65536, passes=3, lanes=4; };
+    // Work for params, in blocks filled; progress reports are in these units.
+    static uint64_t work(const Params& p){ return (uint64_t)blocksFor(p)*p.passes; }
+    // False if the parameters are out of range or progress returned false (cancelled).
+    // progress gets the fraction done after every slice, from the calling thread.
+    static bool derive(const void* pwd,size_t pwdLen,const void* salt,size_t saltLen,const Params& p,uint8_t* out,size_t outLen,
+                       const std::function<bool(double)>& progress=nullptr,const void* secret=nullptr,size_t secretLen=0,const void* ad=nullptr,size_t adLen=0){
+        if(p.lanes<1 || p.lanes>0xFFFFFF || p.passes<1 || p.memoryKiB<8*p.lanes || outLen<4 || saltLen<8) return false;
+        uint8_t h0[72];
+        Blake2b b(64);
+        b.update32(p.lanes).update32((uint32_t)outLen).update32(p.memoryKiB).update32(p.passes).update32(0x13).update32(2);
+        b.update32((uint32_t)pwdLen).update(pwd,pwdLen).update32((uint32_t)saltLen).update(salt,saltLen);
+        b.update32((uint32_t)secretLen).update(secret,secretLen).update32((uint32_t)adLen).update(ad,adLen);
+        b.final(h0);
+        Argon2id a(p);
+        for(uint32_t l=0;l<p.lanes;++l) for(uint32_t i=0;i<2;++i){
+            store32le(h0+64,i); store32le(h0+68,l);
+            uint8_t blk[1024]; hprime(blk,1024,h0,72);
+            for(int w=0;w<128;++w) a.mem[(size_t)(l*a.laneLen+i)*128+w]=load64le(blk+8*w);
+            wipe(blk,sizeof(blk));
+        }
+        wipe(h0,sizeof(h0));
+        unsigned threads=std::max(1u,std::min<unsigned>(p.lanes,std::thread::hardware_concurrency()));
+        for(uint32_t pass=0;pass<p.passes;++pass) for(uint32_t slice=0;slice<4;++slice){
+            auto run=[&](unsigned k){ for(uint32_t l=k;l<p.lanes;l+=threads) a.fillSegment(pass,slice,l); };
+            std::vector<std::thread> pool;
+            for(unsigned k=1;k<threads;++k) pool.emplace_back(run,k);
+            run(0);
+            for(auto& t: pool) t.join();
+            if(progress && !progress(double(pass*4+slice+1)/(p.passes*4))) return false;
+        }
+        uint64_t c[128]={0};
+        for(uint32_t l=0;l<p.lanes;++l) for(int w=0;w<128;++w) c[w]^=a.mem[(size_t)(l*a.laneLen+a.laneLen-1)*128+w];
+        uint8_t cb[1024]; for(int w=0;w<128;++w) store64le(cb+8*w,c[w]);
+        hprime(out,outLen,cb,1024);
+        wipe(c,sizeof(c)); wipe(cb,sizeof(cb));
+        return true;
+    }
+
+private:
+    Params prm; uint32_t laneLen, segLen; std::vector<uint64_t> mem;
+    explicit Argon2id(const Params& p):prm(p){ uint32_t m=blocksFor(p); laneLen=m/p.lanes; segLen=laneLen/4; mem.assign((size_t)m*128,0); }
+    ~Argon2id(){ wipe(mem.data(),mem.size()*8); }
+    static uint32_t blocksFor(const Params& p){ return p.memoryKiB/(4*p.lanes)*4*p.lanes; }
+    static uint64_t load64le(const uint8_t* p){ uint64_t v=0; for(int i=7;i>=0;--i) v=v<<8|p[i]; return v; }
+    static void store64le(uint8_t* p,uint64_t v){ for(int i=0;i<8;++i) p[i]=uint8_t(v>>(8*i)); }
+    static void store32le(uint8_t* p,uint32_t v){ for(int i=0;i<4;++i) p[i]=uint8_t(v>>(8*i)); }
+    // Variable-length hash H' (RFC 9106 3.3).
+    static void hprime(uint8_t* out,size_t outLen,const uint8_t* in,size_t n){
+        if(outLen<=64){ Blake2b(outLen).update32((uint32_t)outLen).update(in,n).final(out); return; }
+        uint8_t v[64]; Blake2b(64).update32((uint32_t)outLen).update(in,n).final(v);
+        size_t r=(outLen+31)/32-2;
+        memcpy(out,v,32); out+=32;
+        for(size_t i=1;i<r;++i){ Blake2b(64).update(v,64).final(v); memcpy(out,v,32); out+=32; }
+        size_t last=outLen-32*r;
+        uint8_t tail[64]; Blake2b(last).update(v,64).final(tail); memcpy(out,tail,last);
+        wipe(v,sizeof(v)); wipe(tail,sizeof(tail));
+    }
+    static uint64_t fBlaMka(uint64_t x,uint64_t y){ return x+y+2*(x&0xFFFFFFFFull)*(y&0xFFFFFFFFull); }
+    static uint64_t rotr(uint64_t x,int n){ return x>>n | x<<(64-n); }
+    static void gb(uint64_t& a,uint64_t& b,uint64_t& c,uint64_t& d){
+        a=fBlaMka(a,b); d=rotr(d^a,32); c=fBlaMka(c,d); b=rotr(b^c,24);
+        a=fBlaMka(a,b); d=rotr(d^a,16); c=fBlaMka(c,d); b=rotr(b^c,63);
+    }
+    static void permute(uint64_t* v0,uint64_t* v1,uint64_t* v2,uint64_t* v3,uint64_t* v4,uint64_t* v5,uint64_t* v6,uint64_t* v7,
+                        uint64_t* v8,uint64_t* v9,uint64_t* v10,uint64_t* v11,uint64_t* v12,uint64_t* v13,uint64_t* v14,uint64_t* v15){
+        gb(*v0,*v4,*v8,*v12); gb(*v1,*v5,*v9,*v13); gb(*v2,*v6,*v10,*v14); gb(*v3,*v7,*v11,*v15);
+        gb(*v0,*v5,*v10,*v15); gb(*v1,*v6,*v11,*v12); gb(*v2,*v7,*v8,*v13); gb(*v3,*v4,*v9,*v14);
+    }
+    // out = G(x, y), or out ^= G(x, y) on later passes.
+    static void compress(const uint64_t* x,const uint64_t* y,uint64_t* out,bool withXor){
+        uint64_t r[128], z[128];
+        for(int i=0;i<128;++i) r[i]=z[i]=x[i]^y[i];
+        for(int i=0;i<8;++i){ uint64_t* q=z+16*i; permute(q,q+1,q+2,q+3,q+4,q+5,q+6,q+7,q+8,q+9,q+10,q+11,q+12,q+13,q+14,q+15); }
+        for(int i=0;i<8;++i){ uint64_t* q=z+2*i; permute(q,q+1,q+16,q+17,q+32,q+33,q+48,q+49,q+64,q+65,q+80,q+81,q+96,q+97,q+112,q+113); }
+        if(withXor) for(int i=0;i<128;++i) out[i]^=z[i]^r[i];
+        else for(int i=0;i<128;++i) out[i]=z[i]^r[i];
+    }
+    uint64_t* blockAt(uint64_t idx){ return mem.data()+idx*128; }
+    void fillSegment(uint32_t pass,uint32_t slice,uint32_t lane){
+        // first half of the first pass uses password-independent addresses (Argon2i)
+        bool indep = pass==0 && slice<2;
+        uint64_t input[128]={0}, addr[128]={0}, zero[128]={0};
+        if(indep){ input[0]=pass; input[1]=lane; input[2]=slice; input[3]=blocksFor(prm); input[4]=prm.passes; input[5]=2; }
+        auto nextAddresses=[&]{ ++input[6]; uint64_t tmp[128]; compress(zero,input,tmp,false); compress(zero,tmp,addr,false); };
+        uint32_t start=0;
+        if(pass==0 && slice==0){ start=2; if(indep) nextAddresses(); }
+        uint64_t cur=(uint64_t)lane*laneLen+slice*segLen+start;
+        uint64_t prev = cur%laneLen==0? cur+laneLen-1 : cur-1;
+        for(uint32_t i=start;i<segLen;++i, ++cur, ++prev){
+            if(cur%laneLen==1) prev=cur-1;
+            uint64_t rnd;
+            if(indep){ if(i%128==0) nextAddresses(); rnd=addr[i%128]; }
+            else rnd=blockAt(prev)[0];
+            uint32_t refLane = pass==0 && slice==0? lane : uint32_t((rnd>>32)%prm.lanes);
+            bool same = refLane==lane;
+            uint64_t area;
+            if(pass==0) area = slice==0? i-1 : same? (uint64_t)slice*segLen+i-1 : (uint64_t)slice*segLen-(i==0? 1 : 0);
+            else area = same? laneLen-segLen+i-1 : laneLen-segLen-(i==0? 1 : 0);
+            uint64_t rel=rnd&0xFFFFFFFFull; rel=rel*rel>>32; rel=area-1-(area*rel>>32);
+            uint64_t startPos = pass!=0 && slice!=3? (uint64_t)(slice+1)*segLen : 0;
+            uint64_t ref=(uint64_t)refLane*laneLen+(startPos+rel)%laneLen;
+            compress(blockAt(prev),blockAt(ref),blockAt(cur),pass!=0);
+        }
+        wipe(input,sizeof(input)); wipe(addr,sizeof(addr));
+    }
+};
+
+} // namespace VaultCrypto
@@ -0,0 +1,302 @@
+// Vault core tests: vault7_tests [name...] runs the named tests, or all of them.
+// Known-answer vectors for the crypto kernels (every kernel this CPU has, not just the one
+// picked at runtime) and behaviour tests for storage. The exit status is the number of
+// failed checks, so ctest reports any.
+#include "../src/vault.h"
+
+namespace Tests {
+    using namespace VaultCrypto;
+    static int failures=0;
+    static void check(bool ok,const string& what){ if(!ok){ ++failures; fprintf(stderr,"  FAIL %s\n", what.c_str()); } }
+
+    static vector<uint8_t> unhex(string_view h){
+        vector<uint8_t> o;
+        auto nib=[](char c){ return c<='9'? c-'0' : (c|0x20)-'a'+10; };
+        for(size_t i=0;i+1<h.size();i+=2) o.push_back(uint8_t(nib(h[i])<<4 | nib(h[i+1])));
+        return o;
+    }
+    static string hex(const uint8_t* p,size_t n){ static const char* d="0123456789abcdef"; string o; for(size_t i=0;i<n;++i){ o+=d[p[i]>>4]; o+=d[p[i]&15]; } return o; }
+    static string hex(const vector<uint8_t>& v){ return hex(v.data(),v.size()); }
+
+    // One AEAD vector through seal and open; a flipped tag bit must not open.
+    struct AeadVector { const char *name, *key, *nonce, *aad, *plain, *cipher, *tag; };
+    static void aeadKat(const Aead& a,const AeadVector& v){
+        string what=string(a.name())+" "+a.kernel()+" "+v.name;
+        auto n=unhex(v.nonce), aad=unhex(v.aad), p=unhex(v.plain);
+        vector<uint8_t> c(p.size()), back(p.size()); uint8_t tag[Aead::TAG];
+        a.seal(n.data(),aad.data(),aad.size(),p.data(),p.size(),c.data(),tag);
+        check(hex(c)==v.cipher, what+": ciphertext "+hex(c));
+        check(hex(tag,sizeof(tag))==v.tag, what+": tag "+hex(tag,sizeof(tag)));
+        check(a.open(n.data(),aad.data(),aad.size(),c.data(),c.size(),tag,back.data()) && back==p, what+": open");
+        tag[0]^=1;
+        check(!a.open(n.data(),aad.data(),aad.size(),c.data(),c.size(),tag,back.data()), what+": tampered tag opens");
+    }
+    // Every length up to a few kernel strides: kernel k seals like the reference r.
+    static void aeadSame(const Aead& k,const Aead& r){
+        uint8_t nonce[Aead::NONCE]={1,2,3,4,5,6,7,8,9,10,11,12}, aad[19]={7};
+        vector<uint8_t> p(1100), a(p.size()), b(p.size());
+        for(size_t i=0;i<p.size();++i) p[i]=uint8_t(i*131+7);
+        for(size_t n=0;n<=p.size();n+= n<600? 1 : 37){
+            uint8_t ta[Aead::TAG], tb[Aead::TAG];
+            k.seal(nonce,aad,n%20,p.data(),n,a.data(),ta); r.seal(nonce,aad,n%20,p.data(),n,b.data(),tb);
+            if(memcmp(a.data(),b.data(),n)!=0 || memcmp(ta,tb,sizeof(ta))!=0){ check(false, string(k.kernel())+" and "+r.kernel()+" differ at "+to_string(n)+" bytes"); return; }
+        }
+    }
+
+    // ---------- AES-256-GCM ----------
+    // The AES-256 cases (13-16) of the GCM specification's test vectors (McGrew & Viega),
+    // as used by NIST's GCM validation.
+    static void aesGcm(){
+        const char* k15="feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308";
+        const char* p15="d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255";
+        const char* c15="522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662898015ad";
+        const AeadVector vs[]={
+            {"case 13", "0000000000000000000000000000000000000000000000000000000000000000","000000000000000000000000","","","","530f8afbc74536b9a963b4f1c4cb738b"},
+            {"case 14", "0000000000000000000000000000000000000000000000000000000000000000","000000000000000000000000","",
+             "00000000000000000000000000000000","cea7403d4d606b6e074ec5d3baf39d18","d0d1c8a799996bf0265b98b5d48ab919"},
+            {"case 15", k15,"cafebabefacedbaddecaf888","",p15,c15,"b094dac5d93471bdec1a502270e3cc6c"},
+            {"case 16", k15,"cafebabefacedbaddecaf888","feedfacedeadbeeffeedfacedeadbeefabaddad2",
+             "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+             "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662","76fc6ece0f4e1768cddf8853bb2d551b"},
+        };
+        for(auto& v: vs){
+            auto key=unhex(v.key);
+            aeadKat(AesGcm(key.data(),false),v);
+            if(AesGcm::hardwareAvailable()) aeadKat(AesGcm(key.data(),true),v);
+        }
+        if(AesGcm::hardwareAvailable()){ auto key=unhex(k15); aeadSame(AesGcm(key.data(),true),AesGcm(key.data(),false)); }
+        else printf("  (no AES-NI: portable kernel only)\n");
+    }
+
+    // ---------- CHACHA20-POLY1305 ----------
+    // RFC 8439 section 2.8.2, on the scalar kernel and every SIMD one this CPU runs.
+    static void chacha(){
+        const AeadVector v={"rfc 8439 2.8.2",
+            "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f","070000004041424344454647","50515253c0c1c2c3c4c5c6c7",
+            "4c616469657320616e642047656e746c656d656e206f662074686520636c617373206f66202739393a204966204920636f756c64206f6666657220796f75206f6e6c79206f6e652074697020666f7220746865206675747572652c2073756e73637265656e20776f756c642062652069742e",
+            "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d63dbea45e8ca9671282fafb69da92728b1a71de0a9e060b2905d6a5b67ecd3b3692ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc3ff4def08e4b7a9de576d26586cec64b6116",
+            "1ae10b594f09e26a7e902ecbd0600691"};
+        using K=ChaCha20Poly1305::Kernel;
+        const Cpu& cpu=Cpu::get();
+        vector<K> kernels{K::Scalar};
+        if(cpu.sse2) kernels.push_back(K::SSE2);
+        if(cpu.avx2) kernels.push_back(K::AVX2);
+        auto key=unhex(v.key);
+        ChaCha20Poly1305 ref(key.data(),K::Scalar);
+        for(K k: kernels){
+            ChaCha20Poly1305 c(key.data(),k);
+            aeadKat(c,v);
+            if(k!=K::Scalar) aeadSame(c,ref);
+        }
+        if(kernels.size()<3) printf("  (%zu of 3 kernels on this CPU)\n", kernels.size());
+    }
+
+    // ---------- ARGON2ID ----------
+    // RFC 9106 section 5.3 (with secret and associated data), and BLAKE2b underneath it.
+    static void argon2id(){
+        auto b2=[](string_view in,size_t outLen){ vector<uint8_t> o(outLen); Blake2b(outLen).update(in.data(),in.size()).final(o.data()); return hex(o); };
+        check(b2("",64)=="786a02f742015903c6c6fd852552d272912f4740e15847618a86e217f71f5419d25e1031afee585313896444934eb04b903a685b1448b755d56f701afe9be2ce", "blake2b-512 of \"\"");
+        check(b2("abc",64)=="ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d17d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923", "blake2b-512 of \"abc\"");
+        string twoBlocks; for(int r=0;r<2;++r) for(int i=0;i<256;++i) twoBlocks+=char(i);
+        check(b2(twoBlocks,32)=="540b20132d8aeae54057cb69c24f95d26a1c472cc700dd450defe9bb796d4f14", "blake2b-256 of 512 bytes");
+
+        uint8_t pwd[32], salt[16], secret[8], ad[12], out[32];
+        memset(pwd,1,sizeof(pwd)); memset(salt,2,sizeof(salt)); memset(secret,3,sizeof(secret)); memset(ad,4,sizeof(ad));
+        Argon2id::Params p; p.memoryKiB=32; p.passes=3; p.lanes=4;
+        bool ok=Argon2id::derive(pwd,sizeof(pwd),salt,sizeof(salt),p,out,sizeof(out),nullptr,secret,sizeof(secret),ad,sizeof(ad));
+        check(ok && hex(out,sizeof(out))=="0d640df58d78766c08c037a34a8b53c9d01ef0452d75b65eb52520e96b01e659", "rfc 9106 5.3: "+hex(out,sizeof(out)));
+        // progress sees every slice and a false return cancels
+        int calls=0;
+        Argon2id::derive(pwd,sizeof(pwd),salt,sizeof(salt),p,out,sizeof(out),[&](double){ ++calls; return true; });
+        check(calls==int(p.passes*4), "progress after each of the "+to_string(p.passes*4)+" slices, got "+to_string(calls));
+        check(!Argon2id::derive(pwd,sizeof(pwd),salt,sizeof(salt),p,out,sizeof(out),[](double){ return false; }), "cancelled derivation succeeds");
+    }
+
+    // ---------- STORAGE ----------
+    // Runs f in a fresh temp directory (the vault works in ./vault_data), then removes it.
+    template<class F> static void inTempDir(const char* name,F&& f){
+        fs::path dir=fs::temp_directory_path()/name, cwd=fs::current_path();
+        std::error_code ec; fs::remove_all(dir,ec); fs::create_directories(dir); fs::current_path(dir);
+        f();
+        fs::current_path(cwd); fs::remove_all(dir,ec);
+    }
+    static string slurp(const fs::path& p){ ifstream in(p,ios::binary); return string(istreambuf_iterator<char>(in),istreambuf_iterator<char>()); }
+
+    // A rotation stopped after its first checkpoint, an already moved entry deleted, then
+    // the rotation run again: everything opens under the new key and the old one is gone.
+    static void rotateResume(){
+        const EntryType P=EntryType::Password; const int n=2500;   // three rotation chunks
+        struct Stop {};
+        for(auto s: {SecureVault::Storage::Files,SecureVault::Storage::Log}){
+            const char* mode= s==SecureVault::Storage::Log? "log" : "files";
+            inTempDir("vault7_tests_rotate",[&]{
+                VaultCrypto::Argon2id::Params cheap; cheap.memoryKiB=64; cheap.passes=1; cheap.lanes=1;
+                string error; char id[16];
+                {
+                    SecureVault v; v.setVerbose(false);
+                    if(!v.setMaster("","m",error) || !v.rewrap("m",cheap) || !v.open(s)){ check(false, string(mode)+": new vault: "+error); return; }
+                    v.beginImport();
+                    for(int i=0;i<n;++i){ snprintf(id,sizeof(id),"svc%05d",i); v.add(P,id,{"user","pw"+to_string(i)}); }
+                    v.endImport();
+                    try { v.rotate("m","turndownforwhat","k2",[](size_t done,size_t,size_t,double){ if(done>0) throw Stop(); },error); check(false, string(mode)+": rotation not stopped"); }
+                    catch(Stop&) {}
+                }
+                check(fs::exists("vault_data/rotation.ckpt"), string(mode)+": no checkpoint after the first chunk");
+                check(slurp("vault_data/vault.hdr").find("RETIRED_VAULT_KEY=")!=string::npos, string(mode)+": old key not kept while rotating");
+                {
+                    SecureVault v; v.setVerbose(false);
+                    if(!v.auth("m") || !v.open(s)){ check(false, string(mode)+": unlock mid-rotation"); return; }
+                    check(v.remove(P,"svc00000"), string(mode)+": remove a moved entry");
+                    size_t moved=0;
+                    check(v.rotate("m","turndownforwhat","k2",[&](size_t,size_t,size_t m,double){ moved=m; },error), string(mode)+": resume: "+error);
+                    check(moved>0 && moved<size_t(n-1), string(mode)+": resume sealed "+to_string(moved)+" entries again, not just the rest");
+                }
+                check(!fs::exists("vault_data/rotation.ckpt"), string(mode)+": checkpoint left behind");
+                check(slurp("vault_data/vault.hdr").find("RETIRED_VAULT_KEY=")==string::npos, string(mode)+": old key still in the header");
+                SecureVault v; v.setVerbose(false);
+                if(!v.auth("m") || !v.open(s)){ check(false, string(mode)+": unlock after rotation"); return; }
+                vector<SecureVault::Plain> out; Secret buf;
+                check(!v.decryptCategory(SecureVault::CAT_ALL,"turndownforwhat",out,buf), string(mode)+": old entry key still valid");
+                check(v.decryptCategory(SecureVault::CAT_ALL,"k2",out,buf) && out.size()==size_t(n-1), string(mode)+": "+to_string(out.size())+" entries under the new key");
+                size_t bad=0; for(auto& p: out) bad+= !p.ok || p.secret()!="pw"+to_string(atoi(p.entry->getIdentifier().c_str()+3));
+                check(bad==0, string(mode)+": "+to_string(bad)+" entries don't open under the new key");
+            });
+        }
+    }
+
+    // The log replays to the last op per key (deletes as tombstones), cuts a torn tail,
+    // and compaction folds it into an image laid out in write order.
+    static void logReplay(){
+        inTempDir("vault7_tests_log",[]{
+            const char P=typeLetter(EntryType::Password);
+            const fs::path logPath="vault_data/vault.log", imgPath="vault_data/vault.img";
+            auto summary=[](const vector<VaultLog::Record>& ops){ string o; for(auto& r: ops) o+=(r.op==VaultLog::PUT? "put " : "del ")+r.id+"="+r.body+"@"+to_string(r.seq)+" "; return o; };
+            {
+                VaultLog log(logPath,imgPath); log.setVerbose(false);
+                check(log.open(0).empty(), "new log has records");
+                log.append(VaultLog::PUT,P,"a","1"); log.append(VaultLog::PUT,P,"b","2"); log.append(VaultLog::PUT,P,"a","3");
+                log.append(VaultLog::DEL,P,"b"); log.append(VaultLog::PUT,P,"c","4");
+                check(!log.append(VaultLog::PUT,P,string(MAX_ID_LEN+1,'x'),"5"), "id longer than a u16 appended");
+            }
+            auto intact=fs::file_size(logPath);
+            { ofstream f(logPath,ios::binary|ios::app); f.write("\x40\0\0\0\x01P",6); }   // crash mid-append
+            {
+                VaultLog log(logPath,imgPath); log.setVerbose(false);
+                auto ops=log.open(0);
+                check(summary(ops)=="put a=3@3 del b=@4 put c=4@5 ", "replay: "+summary(ops));
+                check(fs::file_size(logPath)==intact, "torn tail not cut off");
+                log.append(VaultLog::PUT,P,"d","6");
+                log.compactAsync();
+            }   // the destructor waits for the compaction
+            auto image=[&]{
+                VaultImage img; string o;
+                if(!img.open(imgPath)) return string("no image");
+                vector<VaultImage::Entry> es; for(size_t i=0;i<img.size();++i) es.push_back(img.at(i));
+                for(size_t i=1;i<es.size();++i) if(es[i].id<=es[i-1].id) o+="(index unsorted) ";
+                sort(es.begin(),es.end(),[](auto& a,auto& b){ return a.offset<b.offset; });
+                for(auto& e: es) o+=string(e.id)+"="+string(e.body)+" ";
+                return o;
+            };
+            check(image()=="a=3 c=4 d=6 ", "first compaction, in write order: "+image());
+            check(fs::file_size(logPath)==8, "log not started over");
+            {
+                VaultLog log(logPath,imgPath); log.setVerbose(false);
+                check(log.open(3).empty(), "compacted log replays records");
+                log.append(VaultLog::PUT,P,"a","7"); log.append(VaultLog::DEL,P,"c");
+                check(log.append(VaultLog::PUT,P,string(MAX_ID_LEN,'y'),"8"), "id of the largest length refused");
+                log.compactAsync();
+            }
+            string longId(MAX_ID_LEN,'y');
+            check(image()=="d=6 a=7 "+longId+"=8 ", "second compaction: an edit moves to the end, a delete leaves");
+        });
+    }
+
+    // A flat entry file moved into its hash shard: under group commit there is a committed
+    // copy on disk at every moment, and the flat file goes once the shard copy is in place.
+    static void shardMigration(){
+        inTempDir("vault7_tests_shard",[]{
+            const EntryType P=EntryType::Password;
+            VaultCrypto::Argon2id::Params cheap; cheap.memoryKiB=64; cheap.passes=1; cheap.lanes=1;
+            string error; fs::path sharded, flat;
+            {
+                SecureVault v; v.setVerbose(false);
+                if(!v.setMaster("","m",error) || !v.rewrap("m",cheap) || !v.open(SecureVault::Storage::Files)){ check(false, "new vault: "+error); return; }
+                v.add(P,"Discord",{"user","pw"}); v.flush();
+            }
+            std::error_code ec;
+            for(auto& e: fs::recursive_directory_iterator("vault_data",ec)) if(e.path().extension()==".txt") sharded=e.path();
+            if(sharded.empty()){ check(false, "no entry file written"); return; }
+            flat=sharded.parent_path().parent_path()/sharded.filename();
+            fs::rename(sharded,flat,ec);
+            SecureVault v; v.setVerbose(false);
+            if(!v.auth("m") || !v.open(SecureVault::Storage::Files)){ check(false, "unlock"); return; }
+            check(v.category(P).size()==1, "flat entry not loaded");
+            bool lost=false;
+            for(auto t0=chrono::steady_clock::now(); chrono::steady_clock::now()-t0<chrono::milliseconds(200); this_thread::sleep_for(chrono::milliseconds(1)))
+                lost|= !fs::exists(flat) && !fs::exists(sharded);
+            check(!lost, "flat file deleted before its shard copy was committed");
+            v.flush();
+            check(fs::exists(sharded) && !fs::exists(flat), "not migrated into "+sharded.string());
+        });
+    }
+
+    // page() resumes from its last position; pages at any offset, before and after the
+    // orders change, match the orders rebuilt from scratch.
+    static void pageOrder(){
+        inTempDir("vault7_tests_page",[]{
+            const EntryType P=EntryType::Password; const int n=3000;
+            VaultCrypto::Argon2id::Params cheap; cheap.memoryKiB=64; cheap.passes=1; cheap.lanes=1;
+            string error; char id[16];
+            SecureVault v; v.setVerbose(false);
+            if(!v.setMaster("","m",error) || !v.rewrap("m",cheap) || !v.open(SecureVault::Storage::Files)){ check(false, "new vault: "+error); return; }
+            set<string> title; list<string> viewed;   // the orders, kept the slow way
+            auto add=[&](int i){ snprintf(id,sizeof(id),"svc%05d",i); v.add(P,id,{"user","pw"}); if(title.insert(id).second) viewed.push_back(id); };
+            v.beginImport(); for(int i=0;i<n;++i) add((i*7919)%n); v.endImport();
+            uint32_t rnd=12345; auto next=[&](uint32_t m){ rnd=rnd*1664525u+1013904223u; return (rnd>>8)%m; };
+            size_t bad=0;
+            auto compare=[&](SecureVault::Order o,const auto& ref,size_t from,size_t rows){
+                auto got=v.page(P,o,from,rows);
+                auto it=ref.begin(); for(size_t i=0;i<from && it!=ref.end();++i) ++it;
+                size_t k=0; for(; it!=ref.end() && k<rows; ++it,++k) if(k>=got.size() || got[k]->getIdentifier()!=*it) ++bad;
+                if(got.size()!=k) ++bad;
+            };
+            for(int round=0;round<400;++round){
+                switch(next(4)){
+                case 0: { snprintf(id,sizeof(id),"svc%05d",int(next(n))); string s=id; v.viewed(P,s); auto f=find(viewed.begin(),viewed.end(),s); if(f!=viewed.end()) viewed.splice(viewed.begin(),viewed,f); } break;
+                case 1: { snprintf(id,sizeof(id),"svc%05d",int(next(n))); string s=id; if(v.remove(P,s)){ title.erase(s); viewed.remove(s); } } break;
+                case 2: add(n+round); break;
+                default: break;
+                }
+                // a scroll run from a random place, both ways, then a jump
+                size_t from=next(uint32_t(title.size()+5));
+                for(int step=0;step<4;++step){ compare(SecureVault::Order::Title,title,from,9); compare(SecureVault::Order::Viewed,viewed,from,9); from+= step<2? 3 : size_t(-2); }
+            }
+            check(bad==0, to_string(bad)+" rows differ from the rebuilt orders");
+        });
+    }
+
+    struct Test { const char* name; void (*run)(); };
+    static const Test all[]={
+        {"aes-gcm",aesGcm},
+        {"chacha20-poly1305",chacha},
+        {"argon2id",argon2id},
+        {"rotate-resume",rotateResume},
+        {"log-replay",logReplay},
+        {"shard-migration",shardMigration},
+        {"page-order",pageOrder},
+    };
+    static int run(int argc,char** argv){
+        for(auto& t: all){
+            bool want=argc<2;
+            for(int i=1;i<argc;++i) want|= string(argv[i])==t.name;
+            if(!want) continue;
+            int before=failures;
+            printf("%s\n", t.name); fflush(stdout);
+            t.run();
+            printf("  %s\n", failures==before? "ok" : "FAILED");
+        }
+        return min(failures,125);
+    }
+}
+
+int main(int argc,char** argv){ return Tests::run(argc,argv); }